@@ -8,6 +8,7 @@
 #include "common.h"
 #include "API_PusherModule.h"
 #include "PusherHandler.h"
+#include "PusherEngine.h"
 #include "mp3Parser.h"
 
 _API RTSP_Pusher_Handler _APICALL RTSP_Pusher_Create()
@@ -15,6 +16,49 @@ _API RTSP_Pusher_Handler _APICALL RTSP_Pusher_Create()
 	return PusherHandler::createNew();
 }
 
+_API RTSP_Pusher_Engine _APICALL RTSP_Pusher_Engine_Create(int nThreads)
+{
+	return PusherEngine::createNew(nThreads);
+}
+
+_API int _APICALL RTSP_Pusher_Engine_Release(RTSP_Pusher_Engine engine)
+{
+	PusherEngine* eng = (PusherEngine*) engine;
+	if (eng == NULL) return -1;
+	else return eng->release();
+}
+
+_API int _APICALL RTSP_Pusher_Engine_SetMaxConnecting(RTSP_Pusher_Engine engine, int maxConnecting)
+{
+	PusherEngine* eng = (PusherEngine*) engine;
+	if (eng == NULL) return -1;
+	eng->setMaxConnecting(maxConnecting);
+	return 0;
+}
+
+_API int _APICALL RTSP_Pusher_Engine_SetSendBatching(RTSP_Pusher_Engine engine, int enable, unsigned int flushWindowUs)
+{
+	PusherEngine* eng = (PusherEngine*) engine;
+	if (eng == NULL) return -1;
+	eng->setSendBatching(enable != 0, flushWindowUs);
+	return 0;
+}
+
+_API int _APICALL RTSP_Pusher_Engine_SetIoUring(RTSP_Pusher_Engine engine, int enable)
+{
+	PusherEngine* eng = (PusherEngine*) engine;
+	if (eng == NULL) return -1;
+	eng->setIoUring(enable != 0);
+	return 0;
+}
+
+_API RTSP_Pusher_Handler _APICALL RTSP_Pusher_CreateWithEngine(RTSP_Pusher_Engine engine)
+{
+	PusherEngine* eng = (PusherEngine*) engine;
+	if (eng == NULL) return NULL;
+	else return PusherHandler::createNew(eng);
+}
+
 _API int _APICALL RTSP_Pusher_SetCallback(RTSP_Pusher_Handler handler,\
 		PusherCallback cb, void* cbParam)
 {
@@ -34,6 +78,16 @@ _API int _APICALL RTSP_Pusher_StartStream(RTSP_Pusher_Handler handler, const cha
 }
 
 
+_API int _APICALL RTSP_Pusher_StartStreamAsync(RTSP_Pusher_Handler handler, const char* url, \
+		RTP_ConnectType connType, const char* username, const char* password, int reconn, \
+		 const MediaInfo& mi)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->startStreamAsync(url, connType, username, password, reconn, mi);
+}
+
+
 _API int _APICALL RTSP_Pusher_CloseStream(RTSP_Pusher_Handler handler)
 {
 	PusherHandler* hdr = (PusherHandler*) handler;
@@ -56,6 +110,91 @@ _API int _APICALL RTSP_Pusher_PushFrame(RTSP_Pusher_Handler handler, MediaFrame*
 	else return hdr->pushFrame(frame);
 }
 
+_API int _APICALL RTSP_Pusher_PushPCM(RTSP_Pusher_Handler handler, MediaFrame* frame)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->pushPCM(frame);
+}
+
+_API int _APICALL RTSP_Pusher_PushPCMBatch(RTSP_Pusher_Handler* handlers, MediaFrame** frames, int count, int* results)
+{
+	if (handlers == NULL || frames == NULL || count < 0) return -1;
+	else return PusherHandler::pushPCMBatch((PusherHandler* const*) handlers, frames, count, results);
+}
+
+_API int _APICALL RTSP_Pusher_SetAsyncPush(RTSP_Pusher_Handler handler, int enable, unsigned int ringBytes)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setAsyncPush(enable != 0, ringBytes);
+}
+
+_API int _APICALL RTSP_Pusher_SetPacketization(RTSP_Pusher_Handler handler, unsigned int mtu, unsigned int ptimeMs)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setPacketization(mtu, ptimeMs);
+}
+
+_API int _APICALL RTSP_Pusher_SetCallbackPolicy(RTSP_Pusher_Handler handler, unsigned int progressIntervalMs, int notifierThread)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setCallbackPolicy(progressIntervalMs, notifierThread != 0);
+}
+
+_API int _APICALL RTSP_Pusher_SetSendQueueLimits(RTSP_Pusher_Handler handler, \
+		unsigned int maxPackets, unsigned int maxBytes)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setSendQueueLimits(maxPackets, maxBytes);
+}
+
+_API int _APICALL RTSP_Pusher_SetLatencyBudget(RTSP_Pusher_Handler handler, unsigned int maxLatencyMs)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setLatencyBudget(maxLatencyMs);
+}
+
+_API int _APICALL RTSP_Pusher_GetSendQueueStatus(RTSP_Pusher_Handler handler, \
+		unsigned int* packets, unsigned int* bytes, unsigned int* dropped)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->getSendQueueStatus(packets, bytes, dropped);
+}
+
+_API int _APICALL RTSP_Pusher_SetUDPSegmentation(RTSP_Pusher_Handler handler, int enable)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setUDPSegmentation(enable != 0);
+}
+
+_API int _APICALL RTSP_Pusher_SetZeroCopy(RTSP_Pusher_Handler handler, int enable)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->setZeroCopy(enable != 0);
+}
+
+_API int _APICALL RTSP_Pusher_GetRTCPStats(RTSP_Pusher_Handler handler, RTCPStats* stats)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->getRTCPStats(stats);
+}
+
+_API int _APICALL RTSP_Pusher_GetStats(RTSP_Pusher_Handler handler, PusherStats* stats)
+{
+	PusherHandler* hdr = (PusherHandler*) handler;
+	if (hdr == NULL) return -1;
+	else return hdr->getStats(stats);
+}
+
 _API double _APICALL RTSP_Pusher_Get_MP3_Frame_Duration(void* frameData)
 {    
     FrameParser frmParser;
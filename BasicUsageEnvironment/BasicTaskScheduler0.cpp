@@ -20,27 +20,6 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "BasicUsageEnvironment0.hh"
 #include "HandlerSet.hh"
 
-////////// A subclass of DelayQueueEntry,
-//////////     used to implement BasicTaskScheduler0::scheduleDelayedTask()
-
-class AlarmHandler: public DelayQueueEntry {
-public:
-  AlarmHandler(TaskFunc* proc, void* clientData, DelayInterval timeToDelay)
-    : DelayQueueEntry(timeToDelay), fProc(proc), fClientData(clientData) {
-  }
-
-private: // redefined virtual functions
-  virtual void handleTimeout() {
-    (*fProc)(fClientData);
-    DelayQueueEntry::handleTimeout();
-  }
-
-private:
-  TaskFunc* fProc;
-  void* fClientData;
-};
-
-
 ////////// BasicTaskScheduler0 //////////
 
 BasicTaskScheduler0::BasicTaskScheduler0()
@@ -59,18 +38,18 @@ BasicTaskScheduler0::~BasicTaskScheduler0() {
 TaskToken BasicTaskScheduler0::scheduleDelayedTask(int64_t microseconds,
 						 TaskFunc* proc,
 						 void* clientData) {
-  if (microseconds < 0) microseconds = 0;
-  DelayInterval timeToDelay((long)(microseconds/1000000), (long)(microseconds%1000000));
-  AlarmHandler* alarmHandler = new AlarmHandler(proc, clientData, timeToDelay);
-  fDelayQueue.addEntry(alarmHandler);
-
-  return (void*)(alarmHandler->token());
+  return fTimerWheel.addTimer(microseconds, proc, clientData);
 }
 
 void BasicTaskScheduler0::unscheduleDelayedTask(TaskToken& prevTask) {
-  DelayQueueEntry* alarmHandler = fDelayQueue.removeEntry((intptr_t)prevTask);
+  fTimerWheel.removeTimer(prevTask);
   prevTask = NULL;
-  delete alarmHandler;
+}
+
+TaskToken BasicTaskScheduler0::schedulePeriodicTask(int64_t periodMicroseconds,
+						  PeriodicTaskFunc* proc,
+						  void* clientData) {
+  return fTimerWheel.addPeriodicTimer(periodMicroseconds, proc, clientData);
 }
 
 void BasicTaskScheduler0::doEventLoop(char volatile* watchVariable) {
@@ -107,7 +86,7 @@ EventTriggerId BasicTaskScheduler0::createEventTrigger(TaskFunc* eventHandlerPro
 }
 
 void BasicTaskScheduler0::deleteEventTrigger(EventTriggerId eventTriggerId) {
-  fTriggersAwaitingHandling &=~ eventTriggerId;
+  __atomic_fetch_and(&fTriggersAwaitingHandling, ~eventTriggerId, __ATOMIC_RELAXED);
 
   if (eventTriggerId == fLastUsedTriggerMask) { // common-case optimization:
     fTriggeredEventHandlers[fLastUsedTriggerNum] = NULL;
@@ -137,9 +116,44 @@ void BasicTaskScheduler0::triggerEvent(EventTriggerId eventTriggerId, void* clie
   }
 
   // Then, note this event as being ready to be handled.
-  // (Note that because this function (unlike others in the library) can be called from an external thread, we do this last, to
-  //  reduce the risk of a race condition.)
-  fTriggersAwaitingHandling |= eventTriggerId;
+  // (Note that because this function (unlike others in the library) can be called from an external thread, we do this last,
+  //  atomically - other threads may be setting bits, and the event loop clearing them, at the same time - and with release
+  //  ordering, so that the loop sees the "clientData" once it sees the bit.)
+  __atomic_fetch_or(&fTriggersAwaitingHandling, eventTriggerId, __ATOMIC_RELEASE);
+}
+
+void BasicTaskScheduler0::handleTriggeredEvents() {
+  EventTriggerId pending = __atomic_load_n(&fTriggersAwaitingHandling, __ATOMIC_ACQUIRE);
+  if (pending != 0) {
+    if (pending == fLastUsedTriggerMask) {
+      // Common-case optimization for a single event trigger:
+      __atomic_fetch_and(&fTriggersAwaitingHandling, ~fLastUsedTriggerMask, __ATOMIC_ACQUIRE);
+      if (fTriggeredEventHandlers[fLastUsedTriggerNum] != NULL) {
+	(*fTriggeredEventHandlers[fLastUsedTriggerNum])(fTriggeredEventClientDatas[fLastUsedTriggerNum]);
+      }
+    } else {
+      // Look for an event trigger that needs handling (making sure that we make forward progress through all possible triggers):
+      unsigned i = fLastUsedTriggerNum;
+      EventTriggerId mask = fLastUsedTriggerMask;
+
+      do {
+	i = (i+1)%MAX_NUM_EVENT_TRIGGERS;
+	mask >>= 1;
+	if (mask == 0) mask = 0x80000000;
+
+	if ((pending&mask) != 0) {
+	  __atomic_fetch_and(&fTriggersAwaitingHandling, ~mask, __ATOMIC_ACQUIRE);
+	  if (fTriggeredEventHandlers[i] != NULL) {
+	    (*fTriggeredEventHandlers[i])(fTriggeredEventClientDatas[i]);
+	  }
+
+	  fLastUsedTriggerMask = mask;
+	  fLastUsedTriggerNum = i;
+	  break;
+	}
+      } while (i != fLastUsedTriggerNum);
+    }
+  }
 }
 
 
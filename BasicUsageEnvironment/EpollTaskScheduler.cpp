@@ -0,0 +1,241 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// An "epoll()"-based task scheduler (Linux only)
+// Implementation
+
+#include "EpollTaskScheduler.hh"
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdio.h>
+
+////////// EpollTaskScheduler //////////
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned maxSchedulerGranularity, unsigned maxEventsPerStep) {
+  EpollTaskScheduler* scheduler = new EpollTaskScheduler(maxSchedulerGranularity, maxEventsPerStep);
+  if (!scheduler->initialize()) {
+    delete scheduler;
+    return NULL;
+  }
+
+  return scheduler;
+}
+
+EpollTaskScheduler::EpollTaskScheduler(unsigned maxSchedulerGranularity, unsigned maxEventsPerStep)
+  : fMaxSchedulerGranularity(maxSchedulerGranularity), fEpollFd(-1), fWakeupFd(-1),
+    fEvents(NULL), fMaxEventsPerStep(maxEventsPerStep == 0 ? 1 : maxEventsPerStep),
+    fSocketHandlers(NULL), fSocketHandlersSize(0) {
+}
+
+Boolean EpollTaskScheduler::initialize() {
+  fEpollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (fEpollFd < 0) return False;
+
+  fWakeupFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+  if (fWakeupFd < 0) return False;
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = fWakeupFd;
+  if (epoll_ctl(fEpollFd, EPOLL_CTL_ADD, fWakeupFd, &ev) < 0) return False;
+
+  fEvents = new struct epoll_event[fMaxEventsPerStep];
+
+  if (fMaxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
+  return True;
+}
+
+EpollTaskScheduler::~EpollTaskScheduler() {
+  if (fWakeupFd >= 0) close(fWakeupFd);
+  if (fEpollFd >= 0) close(fEpollFd);
+  delete[] fEvents;
+  delete[] fSocketHandlers;
+}
+
+void EpollTaskScheduler::schedulerTickTask(void* clientData) {
+  ((EpollTaskScheduler*)clientData)->schedulerTickTask();
+}
+
+void EpollTaskScheduler::schedulerTickTask() {
+  scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
+}
+
+void EpollTaskScheduler::triggerEvent(EventTriggerId eventTriggerId, void* clientData) {
+  BasicTaskScheduler0::triggerEvent(eventTriggerId, clientData);
+
+  uint64_t one = 1;
+  if (write(fWakeupFd, &one, sizeof one) < 0) {
+    // EAGAIN: the counter is already non-zero, so "epoll_wait()" wakes up anyway.
+  }
+}
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+void EpollTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  DelayInterval const& timeToDelay = fTimerWheel.timeToNextAlarm();
+  int64_t usToDelay = (int64_t)timeToDelay.seconds()*MILLION + timeToDelay.useconds();
+  // Don't wait any longer than 1 million seconds (11.5 days):
+  if (usToDelay > (int64_t)MILLION*MILLION) usToDelay = (int64_t)MILLION*MILLION;
+  // Also check our "maxDelayTime" parameter (if it's > 0):
+  if (maxDelayTime > 0 && usToDelay > (int64_t)maxDelayTime) usToDelay = maxDelayTime;
+
+  // "epoll_wait()" has millisecond resolution; round up, so that we don't spin before a timer is due:
+  int64_t msToDelay = (usToDelay + 999)/1000;
+  if (msToDelay > 0x7FFFFFFF) msToDelay = 0x7FFFFFFF;
+
+  int numReady = epoll_wait(fEpollFd, fEvents, fMaxEventsPerStep, (int)msToDelay);
+  if (numReady < 0) {
+    if (errno != EINTR && errno != EAGAIN) {
+      // Unexpected error - treat this as fatal:
+      perror("EpollTaskScheduler::SingleStep(): epoll_wait() fails");
+      internalError();
+    }
+    numReady = 0;
+  }
+  fTimerWheel.updateTime();
+
+  // Call the handler function for *every* ready socket:
+  for (int i = 0; i < numReady; ++i) {
+    int sock = fEvents[i].data.fd;
+    unsigned events = fEvents[i].events;
+
+    if (sock == fWakeupFd) {
+      uint64_t count;
+      while (read(fWakeupFd, &count, sizeof count) > 0) {}
+      continue;
+    }
+
+    // Look up the handler now (rather than caching it in the event), because an earlier handler
+    // in this step may have changed or removed it:
+    if (sock >= fSocketHandlersSize) continue;
+    SocketHandler& handler = fSocketHandlers[sock];
+
+    int resultConditionSet = 0;
+    if (events&EPOLLIN) resultConditionSet |= SOCKET_READABLE;
+    if (events&EPOLLOUT) resultConditionSet |= SOCKET_WRITABLE;
+    if (events&EPOLLPRI) resultConditionSet |= SOCKET_EXCEPTION;
+    // Like "select()", report errors and hangups as readiness, so that the handler's next I/O call sees them:
+    if (events&(EPOLLERR|EPOLLHUP)) resultConditionSet |= SOCKET_READABLE|SOCKET_WRITABLE|SOCKET_EXCEPTION;
+
+    resultConditionSet &= handler.conditionSet;
+    if (resultConditionSet != 0 && handler.handlerProc != NULL) {
+      (*handler.handlerProc)(handler.clientData, resultConditionSet);
+    }
+  }
+
+  // Also handle every newly-triggered event. "handleTriggeredEvents()" runs one trigger per call, and the
+  // wakeup counter has been drained above, so go on until none is left (at most one pass per trigger, so that
+  // a handler that keeps re-triggering itself can't starve the sockets; if one still is pending, wake up again):
+  for (unsigned i = 0; i < MAX_NUM_EVENT_TRIGGERS && triggersAwaitingHandling(); ++i) {
+    handleTriggeredEvents();
+  }
+  if (triggersAwaitingHandling()) {
+    uint64_t one = 1;
+    if (write(fWakeupFd, &one, sizeof one) < 0) {
+      // EAGAIN: already signalled.
+    }
+  }
+
+  // Also handle any delayed event that may have come due.
+  fTimerWheel.handleAlarm();
+}
+
+unsigned EpollTaskScheduler::epollEventsFor(int conditionSet) {
+  unsigned events = 0;
+  if (conditionSet&SOCKET_READABLE) events |= EPOLLIN;
+  if (conditionSet&SOCKET_WRITABLE) events |= EPOLLOUT;
+  if (conditionSet&SOCKET_EXCEPTION) events |= EPOLLPRI;
+  if (conditionSet&SOCKET_EDGE_TRIGGERED) events |= EPOLLET;
+  return events;
+}
+
+Boolean EpollTaskScheduler::growHandlerTable(int socketNum) {
+  int newSize = fSocketHandlersSize == 0 ? 64 : fSocketHandlersSize;
+  while (newSize <= socketNum) newSize *= 2;
+
+  SocketHandler* newHandlers = new SocketHandler[newSize];
+  if (newHandlers == NULL) return False;
+
+  for (int i = 0; i < newSize; ++i) {
+    if (i < fSocketHandlersSize) {
+      newHandlers[i] = fSocketHandlers[i];
+    } else {
+      newHandlers[i].conditionSet = 0;
+      newHandlers[i].handlerProc = NULL;
+      newHandlers[i].clientData = NULL;
+    }
+  }
+
+  delete[] fSocketHandlers;
+  fSocketHandlers = newHandlers;
+  fSocketHandlersSize = newSize;
+  return True;
+}
+
+void EpollTaskScheduler
+  ::setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (socketNum < 0) return;
+  if (socketNum >= fSocketHandlersSize) {
+    if (conditionSet == 0) return; // nothing to remove
+    if (!growHandlerTable(socketNum)) return;
+  }
+
+  SocketHandler& handler = fSocketHandlers[socketNum];
+  Boolean wasRegistered = handler.conditionSet != 0;
+
+  if (conditionSet == 0) {
+    if (wasRegistered) epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, NULL);
+    handler.conditionSet = 0;
+    handler.handlerProc = NULL;
+    handler.clientData = NULL;
+    return;
+  }
+
+  struct epoll_event ev;
+  ev.events = epollEventsFor(conditionSet);
+  ev.data.u64 = 0;
+  ev.data.fd = socketNum;
+
+  int result = epoll_ctl(fEpollFd, wasRegistered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, socketNum, &ev);
+  if (result < 0 && errno == ENOENT) {
+    // The socket was closed (and so removed from the epoll set) and its number reused:
+    result = epoll_ctl(fEpollFd, EPOLL_CTL_ADD, socketNum, &ev);
+  } else if (result < 0 && errno == EEXIST) {
+    result = epoll_ctl(fEpollFd, EPOLL_CTL_MOD, socketNum, &ev);
+  }
+  if (result < 0) return;
+
+  handler.conditionSet = conditionSet;
+  handler.handlerProc = handlerProc;
+  handler.clientData = clientData;
+}
+
+void EpollTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum) {
+  if (oldSocketNum < 0 || newSocketNum < 0) return; // sanity check
+  if (oldSocketNum >= fSocketHandlersSize) return;
+
+  SocketHandler handler = fSocketHandlers[oldSocketNum];
+  setBackgroundHandling(oldSocketNum, 0, NULL, NULL);
+  if (handler.conditionSet != 0) {
+    setBackgroundHandling(newSocketNum, handler.conditionSet, handler.handlerProc, handler.clientData);
+  }
+}
+
+#endif
@@ -0,0 +1,413 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Hierarchical timing wheel
+// Implementation
+
+#include "TimerWheel.hh"
+#include <string.h>
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <time.h>
+#endif
+
+static const int64_t MILLION = 1000000;
+
+TimerWheel::TimerWheel(unsigned tickUsecs)
+  : fTickUsecs(tickUsecs == 0 ? 1 : tickUsecs), fCurrentTick(0), fNumInWheel(0),
+    fChunks(NULL), fNumChunks(0), fMaxChunks(0), fFreeList(NULL),
+    fTokenTable(NULL), fTokenTableMask(0), fLastToken(0),
+    fNow(0), fNowIsValid(False), fTimeToNextAlarm(0, 0) {
+  for (unsigned i = 0; i < kNumLevels*kNumSlots; ++i) listInit(&fSlots[i]);
+  memset(fLevel0Bitmap, 0, sizeof fLevel0Bitmap);
+  listInit(&fDue);
+
+  fCurrentTick = (uint64_t)(readClock()/fTickUsecs);
+}
+
+TimerWheel::~TimerWheel() {
+  // Any timers still pending are simply dropped, along with the pool:
+  for (unsigned i = 0; i < fNumChunks; ++i) delete[] fChunks[i];
+  delete[] fChunks;
+  delete[] fTokenTable;
+}
+
+TaskToken TimerWheel::addTimer(int64_t microseconds, TaskFunc* proc, void* clientData) {
+  TimerNode* node = allocNode();
+  if (node == NULL) return NULL;
+
+  node->fProc = proc;
+  node->fPeriodicProc = NULL;
+  node->fClientData = clientData;
+  node->fPeriod = 0;
+
+  if (microseconds <= 0) {
+    node->fExpiry = fCurrentTick;
+    node->fSlot = kSlotDue;
+    listAppend(&fDue, node);
+  } else {
+    node->fExpiry = ticksFor(timeNow() + microseconds);
+    place(node);
+  }
+
+  return (TaskToken)node->fToken;
+}
+
+TaskToken TimerWheel::addPeriodicTimer(int64_t periodMicroseconds, PeriodicTaskFunc* proc, void* clientData) {
+  if (periodMicroseconds <= 0) return NULL;
+
+  TimerNode* node = allocNode();
+  if (node == NULL) return NULL;
+
+  node->fProc = NULL;
+  node->fPeriodicProc = proc;
+  node->fClientData = clientData;
+  node->fPeriod = periodMicroseconds;
+  node->fDeadline = timeNow() + periodMicroseconds;
+  node->fExpiry = ticksFor(node->fDeadline);
+  place(node);
+
+  return (TaskToken)node->fToken;
+}
+
+void TimerWheel::removeTimer(TaskToken token) {
+  TimerNode* node = lookupToken(token);
+  if (node == NULL) return;
+
+  if (node->fSlot >= 0) {
+    unplace(node);
+  } else if (node->fSlot == kSlotDue) {
+    listUnlink(node);
+  } else {
+    // Being called right now: "handleAlarm()" frees it (rather than re-arming it) on return:
+    if (node->fSlot == kSlotFiring) node->fSlot = kSlotCancelled;
+    return;
+  }
+  freeNode(node);
+}
+
+void TimerWheel::updateTime() {
+  fNow = readClock();
+  fNowIsValid = True;
+}
+
+int64_t TimerWheel::timeNow() {
+  return fNowIsValid ? fNow : readClock();
+}
+
+DelayInterval const& TimerWheel::timeToNextAlarm() {
+  if (!listEmpty(&fDue)) {
+    fTimeToNextAlarm = DELAY_ZERO;
+    return fTimeToNextAlarm;
+  }
+  if (fNumInWheel == 0) {
+    fTimeToNextAlarm = DelayInterval(0x7FFFFFFF, MILLION-1); // eternity
+    return fTimeToNextAlarm;
+  }
+
+  // The earliest non-empty level-0 slot in the current rotation is the next alarm.  If there
+  // is none, nothing can come due before the next cascade, so wake up then and look again:
+  uint64_t nextTick;
+  int slot = nextLevel0Slot((unsigned)fCurrentTick & kSlotMask);
+  if (slot >= 0) {
+    nextTick = (fCurrentTick & ~(uint64_t)kSlotMask) + slot;
+  } else {
+    nextTick = (fCurrentTick | kSlotMask) + 1;
+  }
+
+  int64_t usToDelay = (int64_t)nextTick*fTickUsecs - readClock();
+  if (usToDelay < 0) usToDelay = 0;
+  fTimeToNextAlarm = DelayInterval((time_base_seconds)(usToDelay/MILLION), (time_base_seconds)(usToDelay%MILLION));
+  return fTimeToNextAlarm;
+}
+
+void TimerWheel::handleAlarm() {
+  advance((uint64_t)(timeNow()/fTickUsecs));
+
+  // Detach the due list first, so that a handler that schedules a zero-delay task (e.g., itself)
+  // gets called in the next step, rather than looping here forever:
+  TimerNode firing;
+  listInit(&firing);
+  listSplice(&fDue, &firing);
+
+  while (!listEmpty(&firing)) {
+    TimerNode* node = firing.fNext;
+    listUnlink(node);
+    node->fSlot = kSlotFiring;
+
+    if (node->fPeriod == 0) {
+      (*node->fProc)(node->fClientData);
+      freeNode(node);
+      continue;
+    }
+
+    // Periodic: the next deadline follows from the previous one - not from when we got here -
+    // so lateness never accumulates.  Whole periods that have already gone by are skipped and reported:
+    int64_t lateness = timeNow() - node->fDeadline;
+    unsigned missedTicks = lateness >= node->fPeriod ? (unsigned)(lateness/node->fPeriod) : 0;
+    node->fDeadline += (int64_t)(missedTicks + 1)*node->fPeriod;
+
+    (*node->fPeriodicProc)(node->fClientData, missedTicks);
+
+    if (node->fSlot == kSlotFiring) {
+      node->fExpiry = ticksFor(node->fDeadline);
+      place(node);
+    } else {
+      freeNode(node); // it was unscheduled from within the handler
+    }
+  }
+
+  fNowIsValid = False;
+}
+
+void TimerWheel::listAppend(TimerNode* head, TimerNode* node) {
+  node->fPrev = head->fPrev;
+  node->fNext = head;
+  head->fPrev->fNext = node;
+  head->fPrev = node;
+}
+
+void TimerWheel::listUnlink(TimerNode* node) {
+  node->fPrev->fNext = node->fNext;
+  node->fNext->fPrev = node->fPrev;
+  node->fNext = node->fPrev = node;
+}
+
+void TimerWheel::listSplice(TimerNode* from, TimerNode* to) {
+  if (listEmpty(from)) return;
+
+  TimerNode* first = from->fNext;
+  TimerNode* last = from->fPrev;
+  first->fPrev = to->fPrev;
+  to->fPrev->fNext = first;
+  last->fNext = to;
+  to->fPrev = last;
+  listInit(from);
+}
+
+TimerWheel::TimerNode* TimerWheel::allocNode() {
+  if (fFreeList == NULL) {
+    // Keep the token table (a power of two in size) at most half full, with every node of the pool in use:
+    unsigned numNodes = (fNumChunks + 1)*kChunkSize;
+    if (fTokenTable == NULL || 2*numNodes > fTokenTableMask + 1) {
+      if (!growTokenTable(fTokenTable == NULL ? 2*kChunkSize : 2*(fTokenTableMask + 1))) return NULL;
+    }
+
+    if (fNumChunks == fMaxChunks) {
+      unsigned newMaxChunks = fMaxChunks == 0 ? 16 : 2*fMaxChunks;
+      TimerNode** newChunks = new TimerNode*[newMaxChunks];
+      if (newChunks == NULL) return NULL;
+      for (unsigned i = 0; i < fNumChunks; ++i) newChunks[i] = fChunks[i];
+      delete[] fChunks;
+      fChunks = newChunks;
+      fMaxChunks = newMaxChunks;
+    }
+
+    TimerNode* chunk = new TimerNode[kChunkSize];
+    if (chunk == NULL) return NULL;
+    for (int i = kChunkSize-1; i >= 0; --i) {
+      chunk[i].fToken = 0;
+      chunk[i].fSlot = kSlotFree;
+      chunk[i].fPrev = NULL;
+      chunk[i].fNext = fFreeList;
+      fFreeList = &chunk[i];
+    }
+    fChunks[fNumChunks++] = chunk;
+  }
+
+  TimerNode* node = fFreeList;
+  fFreeList = node->fNext;
+  node->fNext = node->fPrev = node;
+
+  // The next value of the counter that no pending timer holds (only after a wrap-around can one):
+  do {
+    ++fLastToken;
+  } while (fLastToken == 0 || lookupToken((TaskToken)fLastToken) != NULL);
+  node->fToken = fLastToken;
+  insertToken(node);
+  return node;
+}
+
+void TimerWheel::freeNode(TimerNode* node) {
+  node->fSlot = kSlotFree;
+  eraseToken(node); // any outstanding token for this node now finds nothing
+  node->fToken = 0;
+  node->fProc = NULL;
+  node->fPeriodicProc = NULL;
+  node->fClientData = NULL;
+  node->fNext = fFreeList;
+  fFreeList = node;
+}
+
+TimerWheel::TimerNode* TimerWheel::lookupToken(TaskToken token) {
+  uintptr_t t = (uintptr_t)token;
+  if (t == 0 || fTokenTable == NULL) return NULL;
+
+  for (unsigned i = tokenSlot(t); fTokenTable[i] != NULL; i = (i+1)&fTokenTableMask) {
+    if (fTokenTable[i]->fToken == t) return fTokenTable[i];
+  }
+  return NULL;
+}
+
+Boolean TimerWheel::growTokenTable(unsigned size) {
+  TimerNode** newTable = new TimerNode*[size];
+  if (newTable == NULL) return False;
+  memset(newTable, 0, size*sizeof(TimerNode*));
+
+  TimerNode** oldTable = fTokenTable;
+  unsigned oldSize = fTokenTable == NULL ? 0 : fTokenTableMask + 1;
+  fTokenTable = newTable;
+  fTokenTableMask = size - 1;
+  for (unsigned i = 0; i < oldSize; ++i) {
+    if (oldTable[i] != NULL) insertToken(oldTable[i]);
+  }
+  delete[] oldTable;
+  return True;
+}
+
+void TimerWheel::insertToken(TimerNode* node) {
+  unsigned i = tokenSlot(node->fToken);
+  while (fTokenTable[i] != NULL) i = (i+1)&fTokenTableMask;
+  fTokenTable[i] = node;
+}
+
+void TimerWheel::eraseToken(TimerNode* node) {
+  unsigned i = tokenSlot(node->fToken);
+  while (fTokenTable[i] != node) i = (i+1)&fTokenTableMask;
+
+  // Move later entries of the same probe run back into the gap, so that no lookup stops short of them:
+  for (unsigned j = (i+1)&fTokenTableMask; fTokenTable[j] != NULL; j = (j+1)&fTokenTableMask) {
+    unsigned home = tokenSlot(fTokenTable[j]->fToken);
+    if (((j - home)&fTokenTableMask) >= ((j - i)&fTokenTableMask)) {
+      fTokenTable[i] = fTokenTable[j];
+      i = j;
+    }
+  }
+  fTokenTable[i] = NULL;
+}
+
+void TimerWheel::place(TimerNode* node) {
+  if (node->fExpiry < fCurrentTick) {
+    // Its tick has already been processed:
+    node->fSlot = kSlotDue;
+    listAppend(&fDue, node);
+    return;
+  }
+
+  uint64_t delta = node->fExpiry - fCurrentTick;
+  uint64_t slotTick = node->fExpiry;
+  unsigned level = 0;
+  while (level < kNumLevels-1 && delta >= ((uint64_t)1<<(kSlotBits*(level+1)))) ++level;
+  if (delta >= ((uint64_t)1<<(kSlotBits*kNumLevels))) {
+    // Beyond the wheel's range: park it in the farthest slot; it gets placed again when that slot cascades:
+    slotTick = fCurrentTick + ((uint64_t)1<<(kSlotBits*kNumLevels)) - 1;
+  }
+
+  unsigned slot = (unsigned)(slotTick>>(kSlotBits*level)) & kSlotMask;
+  node->fSlot = level*kNumSlots + slot;
+  listAppend(&fSlots[node->fSlot], node);
+  ++fNumInWheel;
+  if (level == 0) fLevel0Bitmap[slot>>6] |= (uint64_t)1<<(slot&63);
+}
+
+void TimerWheel::unplace(TimerNode* node) {
+  int slot = node->fSlot;
+  listUnlink(node);
+  --fNumInWheel;
+  if (slot < kNumSlots && listEmpty(&fSlots[slot])) {
+    fLevel0Bitmap[slot>>6] &=~ ((uint64_t)1<<(slot&63));
+  }
+}
+
+static inline unsigned lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctzll(bits);
+#else
+  unsigned n = 0;
+  while ((bits&1) == 0) { bits >>= 1; ++n; }
+  return n;
+#endif
+}
+
+int TimerWheel::nextLevel0Slot(unsigned from) const {
+  for (unsigned w = from>>6; w < kNumSlots/64; ++w) {
+    uint64_t bits = fLevel0Bitmap[w];
+    if (w == (from>>6)) bits &= ~(uint64_t)0 << (from&63);
+    if (bits != 0) return (int)(w*64 + lowestBit(bits));
+  }
+  return -1;
+}
+
+void TimerWheel::cascade(unsigned level) {
+  unsigned slot = (unsigned)(fCurrentTick>>(kSlotBits*level)) & kSlotMask;
+  TimerNode* head = &fSlots[level*kNumSlots + slot];
+
+  TimerNode pending;
+  listInit(&pending);
+  listSplice(head, &pending);
+  while (!listEmpty(&pending)) {
+    TimerNode* node = pending.fNext;
+    listUnlink(node);
+    --fNumInWheel;
+    place(node); // into a lower level (or back here, if it's still out of range)
+  }
+}
+
+void TimerWheel::advance(uint64_t nowTick) {
+  while (fCurrentTick <= nowTick) {
+    if (fNumInWheel == 0) {
+      fCurrentTick = nowTick + 1;
+      break;
+    }
+
+    unsigned index = (unsigned)fCurrentTick & kSlotMask;
+    if (index == 0) {
+      // Refill the lower levels from the higher ones, as each wraps around:
+      for (unsigned level = 1; level < kNumLevels; ++level) {
+	cascade(level);
+	if (((fCurrentTick>>(kSlotBits*level)) & kSlotMask) != 0) break;
+      }
+    }
+
+    TimerNode* head = &fSlots[index];
+    while (!listEmpty(head)) {
+      TimerNode* node = head->fNext;
+      listUnlink(node);
+      --fNumInWheel;
+      node->fSlot = kSlotDue;
+      listAppend(&fDue, node);
+    }
+    fLevel0Bitmap[index>>6] &=~ ((uint64_t)1<<(index&63));
+    ++fCurrentTick;
+
+    if ((fCurrentTick & kSlotMask) != 0 && nextLevel0Slot(0) < 0) {
+      // Nothing can come due before the next cascade; skip the empty ticks:
+      uint64_t nextCascade = (fCurrentTick | kSlotMask) + 1;
+      fCurrentTick = nextCascade <= nowTick ? nextCascade : nowTick + 1;
+    }
+  }
+}
+
+int64_t TimerWheel::readClock() {
+#if defined(__WIN32__) || defined(_WIN32)
+  struct timeval tvNow;
+  gettimeofday(&tvNow, NULL);
+  return (int64_t)tvNow.tv_sec*MILLION + tvNow.tv_usec;
+#else
+  // Monotonic, so that a change to the system clock doesn't fire (or stall) every timer:
+  struct timespec tsNow;
+  clock_gettime(CLOCK_MONOTONIC, &tsNow);
+  return (int64_t)tsNow.tv_sec*MILLION + tsNow.tv_nsec/1000;
+#endif
+}
@@ -28,8 +28,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "UsageEnvironment.hh"
 #endif
 
-#ifndef _DELAY_QUEUE_HH
-#include "DelayQueue.hh"
+#ifndef _TIMER_WHEEL_HH
+#include "TimerWheel.hh"
 #endif
 
 #define RESULT_MSG_BUFFER_MAX 1000
@@ -85,6 +85,8 @@ public:
   virtual TaskToken scheduleDelayedTask(int64_t microseconds, TaskFunc* proc,
 				void* clientData);
   virtual void unscheduleDelayedTask(TaskToken& prevTask);
+  virtual TaskToken schedulePeriodicTask(int64_t periodMicroseconds, PeriodicTaskFunc* proc,
+				 void* clientData);
 
   virtual void doEventLoop(char volatile* watchVariable);
 
@@ -95,16 +97,24 @@ public:
 protected:
   BasicTaskScheduler0();
 
+  void handleTriggeredEvents();
+      // Calls the handler of one pending 'triggered event' (if any), making
+      // forward progress through all of the event triggers.
+  Boolean triggersAwaitingHandling() const {
+    return __atomic_load_n(&fTriggersAwaitingHandling, __ATOMIC_RELAXED) != 0;
+  }
+
 protected:
-  // To implement delayed operations:
-  DelayQueue fDelayQueue;
+  // To implement delayed operations.  (Subclasses call "fTimerWheel.updateTime()" once they
+  // return from waiting, so that timers scheduled by handlers within the same step share one clock read.)
+  TimerWheel fTimerWheel;
 
   // To implement background reads:
   HandlerSet* fHandlers;
   int fLastHandledSocketNum;
 
   // To implement event triggers:
-  EventTriggerId volatile fTriggersAwaitingHandling; // implemented as a 32-bit bitmap
+  EventTriggerId fTriggersAwaitingHandling; // implemented as a 32-bit bitmap; only accessed atomically
   EventTriggerId fLastUsedTriggerMask; // implemented as a 32-bit bitmap
   TaskFunc* fTriggeredEventHandlers[MAX_NUM_EVENT_TRIGGERS];
   void* fTriggeredEventClientDatas[MAX_NUM_EVENT_TRIGGERS];
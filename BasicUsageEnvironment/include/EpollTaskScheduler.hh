@@ -0,0 +1,86 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// An "epoll()"-based task scheduler (Linux only)
+// C++ header
+
+#ifndef _EPOLL_TASK_SCHEDULER_HH
+#define _EPOLL_TASK_SCHEDULER_HH
+
+#if defined(__linux__)
+
+#ifndef _BASIC_USAGE_ENVIRONMENT0_HH
+#include "BasicUsageEnvironment0.hh"
+#endif
+
+struct epoll_event; // forward
+
+class EpollTaskScheduler: public BasicTaskScheduler0 {
+public:
+  static EpollTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/,
+				       unsigned maxEventsPerStep = 1024);
+    // Unlike "BasicTaskScheduler", there is no limit on socket numbers (no "FD_SETSIZE"), and
+    // every socket that is ready when we wake up gets its handler called within the same "SingleStep()".
+    // Sockets registered with "SOCKET_EDGE_TRIGGERED" are reported only when their state changes,
+    // so their handlers must read/write until EAGAIN.
+    // (Returns NULL if "epoll_create()" fails.)
+  virtual ~EpollTaskScheduler();
+
+  // Redefined virtual functions:
+  virtual void triggerEvent(EventTriggerId eventTriggerId, void* clientData = NULL);
+      // Also wakes up "epoll_wait()", so that the event is handled without waiting for the next scheduler tick.
+
+protected:
+  EpollTaskScheduler(unsigned maxSchedulerGranularity, unsigned maxEventsPerStep);
+      // called only by "createNew()"
+  Boolean initialize();
+
+  static void schedulerTickTask(void* clientData);
+  void schedulerTickTask();
+
+protected:
+  // Redefined virtual functions:
+  virtual void SingleStep(unsigned maxDelayTime);
+
+  virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
+  virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
+
+private:
+  static unsigned epollEventsFor(int conditionSet);
+
+  // Per-socket handler state, indexed directly by socket number:
+  struct SocketHandler {
+    int conditionSet;
+    BackgroundHandlerProc* handlerProc;
+    void* clientData;
+  };
+  Boolean growHandlerTable(int socketNum);
+
+protected:
+  unsigned fMaxSchedulerGranularity;
+
+private:
+  int fEpollFd;
+  int fWakeupFd; // an "eventfd()" used by "triggerEvent()"
+  struct epoll_event* fEvents;
+  unsigned fMaxEventsPerStep;
+
+  SocketHandler* fSocketHandlers;
+  int fSocketHandlersSize;
+};
+
+#endif
+
+#endif
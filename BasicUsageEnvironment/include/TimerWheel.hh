@@ -0,0 +1,127 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Hierarchical timing wheel, used (instead of "DelayQueue") to implement
+// "BasicTaskScheduler0::scheduleDelayedTask()"
+// C++ header
+
+#ifndef _TIMER_WHEEL_HH
+#define _TIMER_WHEEL_HH
+
+#ifndef _DELAY_QUEUE_HH
+#include "DelayQueue.hh"
+#endif
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+// Four levels of 256 slots each, with a 1 ms tick, cover 2^32 ms (~49 days);
+// timers further out than that are parked in the last slot and re-inserted
+// when it cascades.
+// Adding and removing a timer are O(1).  Timer nodes come from a pool owned
+// by the wheel, so scheduling a task does not allocate in the steady state.
+// A "TaskToken" is the value of a counter, unique among pending timers, and is
+// looked up in a hash table; a stale token can only match again once the
+// counter has wrapped (2^32 timers later on 32-bit systems).
+class TimerWheel {
+public:
+  TimerWheel(unsigned tickUsecs = 1000);
+  virtual ~TimerWheel();
+
+  TaskToken addTimer(int64_t microseconds, TaskFunc* proc, void* clientData);
+      // "microseconds" <= 0 means: as soon as possible (the next "handleAlarm()")
+  TaskToken addPeriodicTimer(int64_t periodMicroseconds, PeriodicTaskFunc* proc, void* clientData);
+      // Fires every "periodMicroseconds" (from now), on absolute deadlines; the timer node is reused for each period
+  void removeTimer(TaskToken token);
+      // Has no effect if "token" is NULL, or the timer has already fired or been removed.
+      // May be called from within the timer's own handler (e.g., to stop a periodic timer)
+
+  // Reads the (monotonic) clock.  Schedulers call this once after waiting for
+  // I/O; the time is then reused by every "addTimer()" made until the end of
+  // the following "handleAlarm()".  (Outside that window, "addTimer()" reads
+  // the clock itself.)
+  void updateTime();
+  int64_t timeNow(); // in microseconds, on the monotonic clock
+
+  DelayInterval const& timeToNextAlarm();
+  void handleAlarm(); // calls every timer that has come due
+
+private:
+  struct TimerNode {
+    TimerNode* fNext;
+    TimerNode* fPrev;
+    uint64_t fExpiry; // in ticks
+    TaskFunc* fProc;
+    PeriodicTaskFunc* fPeriodicProc;
+    void* fClientData;
+    int64_t fPeriod; // in microseconds; 0 for a one-shot timer
+    int64_t fDeadline; // periodic timers only: the absolute time (in microseconds) of the next call
+    uintptr_t fToken; // 0 while the node is free
+    int fSlot; // level*kNumSlots + slot, or one of the values below
+  };
+  enum { kSlotFree = -1, kSlotDue = -2, kSlotFiring = -3, kSlotCancelled = -4 };
+  enum { kNumLevels = 4, kSlotBits = 8, kNumSlots = 1<<kSlotBits, kSlotMask = kNumSlots-1 };
+  enum { kChunkSize = 256 };
+
+  static void listInit(TimerNode* head) { head->fNext = head->fPrev = head; }
+  static Boolean listEmpty(TimerNode* head) { return head->fNext == head; }
+  static void listAppend(TimerNode* head, TimerNode* node);
+  static void listUnlink(TimerNode* node);
+  static void listSplice(TimerNode* from, TimerNode* to); // moves everything from "from" to the end of "to"
+
+  TimerNode* allocNode();
+  uint64_t ticksFor(int64_t deadline) const { return (uint64_t)((deadline + fTickUsecs - 1)/fTickUsecs); }
+      // rounded up, so that a timer never fires early
+  void freeNode(TimerNode* node);
+  TimerNode* lookupToken(TaskToken token);
+  unsigned tokenSlot(uintptr_t token) const { return (unsigned)token & fTokenTableMask; }
+  Boolean growTokenTable(unsigned size);
+  void insertToken(TimerNode* node);
+  void eraseToken(TimerNode* node);
+
+  void place(TimerNode* node); // puts "node" in the slot for its expiry
+  void unplace(TimerNode* node);
+  int nextLevel0Slot(unsigned from) const; // -1 if slots [from,kNumSlots) are all empty
+  void cascade(unsigned level);
+  void advance(uint64_t nowTick);
+
+  static int64_t readClock();
+
+private:
+  unsigned fTickUsecs;
+  uint64_t fCurrentTick; // the next tick to be processed
+  unsigned fNumInWheel;
+
+  TimerNode fSlots[kNumLevels*kNumSlots]; // list heads
+  uint64_t fLevel0Bitmap[kNumSlots/64]; // non-empty level-0 slots
+  TimerNode fDue; // list head: timers that are due at the next "handleAlarm()"
+
+  TimerNode** fChunks;
+  unsigned fNumChunks;
+  unsigned fMaxChunks;
+  TimerNode* fFreeList;
+
+  // Open addressing (linear probing), at most half full: the node of each pending timer, by its token
+  TimerNode** fTokenTable;
+  unsigned fTokenTableMask;
+  uintptr_t fLastToken;
+
+  int64_t fNow;
+  Boolean fNowIsValid;
+  DelayInterval fTimeToNextAlarm;
+};
+
+#endif
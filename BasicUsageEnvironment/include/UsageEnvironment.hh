@@ -102,6 +102,7 @@ private:
 
 
 typedef void TaskFunc(void* clientData);
+typedef void PeriodicTaskFunc(void* clientData, unsigned missedTicks);
 typedef void* TaskToken;
 typedef u_int32_t EventTriggerId;
 
@@ -130,6 +131,15 @@ public:
         // (setting "task" to the new task token).
         // Note: This MUST NOT be called if the scheduled task has already occurred.
 
+  virtual TaskToken schedulePeriodicTask(int64_t periodMicroseconds, PeriodicTaskFunc* proc,
+					 void* clientData) = 0;
+	// Schedules a task to occur every "periodMicroseconds", starting one period from now,
+	// until it is stopped with "unscheduleDelayedTask()" (which may be called from within "proc").
+	// The deadlines are absolute (start + n*period, on a monotonic clock), so a late call
+	// doesn't delay the ones after it.  If whole periods have gone by before "proc" gets called,
+	// it is called just once, with "missedTicks" set to the number of periods that were skipped.
+	// (Returns NULL if "periodMicroseconds" <= 0)
+
   // For handling socket operations in the background (from the event loop):
   typedef void BackgroundHandlerProc(void* clientData, int mask);
     // Possible bits to set in "mask".  (These are deliberately defined
@@ -137,6 +147,9 @@ public:
     #define SOCKET_READABLE    (1<<1)
     #define SOCKET_WRITABLE    (1<<2)
     #define SOCKET_EXCEPTION   (1<<3)
+    // May be or'ed into "conditionSet" to request edge-triggered notification, where the scheduler
+    // supports it (see "EpollTaskScheduler").  Schedulers that don't support it ignore this bit:
+    #define SOCKET_EDGE_TRIGGERED (1<<4)
   virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) = 0;
   void disableBackgroundHandling(int socketNum) { setBackgroundHandling(socketNum, 0, NULL, NULL); }
   virtual void moveSocketHandling(int oldSocketNum, int newSocketNum) = 0;
@@ -0,0 +1,172 @@
+/**
+ * @file CallbackNotifier.cpp
+ * @brief  推送状态回调通知线程实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-04
+ */
+#include "CallbackNotifier.h"
+#include <stddef.h>
+
+CallbackNotifier* CallbackNotifier::s_instance = NULL;
+pthread_once_t CallbackNotifier::s_once = PTHREAD_ONCE_INIT;
+
+CallbackNotifier* CallbackNotifier::instance()
+{
+	pthread_once(&s_once, createInstance);
+	return s_instance;
+}
+
+void CallbackNotifier::createInstance()
+{
+	CallbackNotifier* notifier = new CallbackNotifier();
+	if (notifier != NULL && notifier->start() != 0)
+	{
+		// the thread never started: nothing else refers to it
+		delete[] notifier->m_events;
+		pthread_mutex_destroy(&notifier->m_overflowLock);
+		delete notifier;
+		notifier = NULL;
+	}
+	s_instance = notifier;
+}
+
+CallbackNotifier::CallbackNotifier()
+	: m_events(NULL), m_numOverflow(0)
+{
+	pthread_mutex_init(&m_overflowLock, NULL);
+}
+
+int CallbackNotifier::start()
+{
+	if (m_free.init(kCapacity) != 0 || m_ready.init(kCapacity) != 0)
+		return -1;
+
+	m_events = new Event[kCapacity];
+	if (m_events == NULL) return -1;
+	for (int i = 0; i < kCapacity; i++)
+		m_free.tryPush(&m_events[i]);
+
+	if (pthread_create(&m_tid, NULL, threadProc, this) != 0)
+		return -1;
+	pthread_detach(m_tid);
+	return 0;
+}
+
+void* CallbackNotifier::threadProc(void* arg)
+{
+	((CallbackNotifier*) arg)->run();
+	return NULL;
+}
+
+void CallbackNotifier::run()
+{
+	for (;;)
+	{
+		Event* ev = m_ready.pop();
+		if (ev->cb != NULL)
+		{
+			ev->cb(ev->state, ev->code, ev->param);
+		}
+		else
+		{
+			SyncPoint* sp = ev->sync;
+			pthread_mutex_lock(&sp->lock);
+			sp->done = true;
+			pthread_cond_signal(&sp->cond);
+			pthread_mutex_unlock(&sp->lock);
+		}
+		m_free.push(ev);
+
+		if (__atomic_load_n(&m_numOverflow, __ATOMIC_SEQ_CST) != 0)
+		{
+			pthread_mutex_lock(&m_overflowLock);
+			refill();
+			pthread_mutex_unlock(&m_overflowLock);
+		}
+	}
+}
+
+bool CallbackNotifier::onNotifierThread() const
+{
+	return pthread_equal(pthread_self(), m_tid) != 0;
+}
+
+bool CallbackNotifier::enqueue(const Event& e, bool mustDeliver)
+{
+	// lock free while nothing has overflowed
+	if (__atomic_load_n(&m_numOverflow, __ATOMIC_SEQ_CST) == 0)
+	{
+		Event* ev = m_free.tryPop();
+		if (ev != NULL)
+		{
+			*ev = e;
+			m_ready.push(ev);	// as many cells as events: never blocks
+			return true;
+		}
+	}
+	if (!mustDeliver) return false;
+
+	pthread_mutex_lock(&m_overflowLock);
+	m_overflow.push_back(e);
+	__atomic_store_n(&m_numOverflow, (int)m_overflow.size(), __ATOMIC_SEQ_CST);
+	// the notifier may have made room before it saw the count
+	refill();
+	pthread_mutex_unlock(&m_overflowLock);
+	return true;
+}
+
+void CallbackNotifier::refill()
+{
+	while (!m_overflow.empty())
+	{
+		Event* ev = m_free.tryPop();
+		if (ev == NULL) break;
+
+		*ev = m_overflow.front();
+		m_overflow.pop_front();
+		m_ready.push(ev);
+	}
+	__atomic_store_n(&m_numOverflow, (int)m_overflow.size(), __ATOMIC_SEQ_CST);
+}
+
+bool CallbackNotifier::post(PusherCallback cb, RTSP_Pusher_State state, int code, void* param, bool mustDeliver)
+{
+	if (onNotifierThread())
+	{
+		// made right away, inside the callback that caused it
+		cb(state, code, param);
+		return true;
+	}
+
+	Event e;
+	e.cb = cb;
+	e.param = param;
+	e.state = state;
+	e.code = code;
+	e.sync = NULL;
+	return enqueue(e, mustDeliver);
+}
+
+void CallbackNotifier::sync()
+{
+	if (onNotifierThread()) return;
+
+	SyncPoint sp;
+	pthread_mutex_init(&sp.lock, NULL);
+	pthread_cond_init(&sp.cond, NULL);
+	sp.done = false;
+
+	// behind whatever overflowed, too
+	Event e = Event();
+	e.sync = &sp;
+	enqueue(e, true);
+
+	pthread_mutex_lock(&sp.lock);
+	while (!sp.done)
+		pthread_cond_wait(&sp.cond, &sp.lock);
+	pthread_mutex_unlock(&sp.lock);
+
+	pthread_cond_destroy(&sp.cond);
+	pthread_mutex_destroy(&sp.lock);
+}
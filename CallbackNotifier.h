@@ -0,0 +1,84 @@
+/**
+ * @file CallbackNotifier.h
+ * @brief  在单独的通知线程上调用推送状态回调
+ *
+ *	推送线程和事件循环线程只把回调事件放进无锁队列(RingQueue)就返回, 不执行应用的
+ *	回调代码; 通知线程按入队顺序逐个调用. 事件对象预先分配, 入队出队都不调用 malloc.
+ *	队列满时, 必须送达的事件按顺序放进溢出链表, 由通知线程随后收回, 投递方从不等待:
+ *	回调里调用的接口(如 RTSP_Pusher_Release)可能要等事件循环线程, 循环线程再等通知线程就会死锁.
+ *	进程内只有一个通知线程, 首次使用时创建, 随进程存在.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-04
+ */
+#ifndef CALLBACK_NOTIFIER_H
+#define CALLBACK_NOTIFIER_H
+
+#include <pthread.h>
+#include <deque>
+#include "API_PusherTypes.h"
+#include "RingQueue.h"
+
+class CallbackNotifier
+{
+	public:
+		enum { kCapacity = 4096 };	// events queued at most, over all handlers
+
+		// The process' notifier, started on first use. NULL if it couldn't be.
+		static CallbackNotifier* instance();
+
+		// Queues cb(state, code, param) for the notifier thread. While the
+		// queue is full, the event goes onto the overflow list if
+		// "mustDeliver", otherwise it is dropped and false returned. Never
+		// waits. On the notifier thread itself (a callback causing another
+		// one) the callback is made right away.
+		bool post(PusherCallback cb, RTSP_Pusher_State state, int code, void* param, bool mustDeliver);
+
+		// Returns once every event queued before has been delivered.
+		void sync();
+
+	private:
+		// what sync() waits on
+		struct SyncPoint
+		{
+			pthread_mutex_t lock;
+			pthread_cond_t cond;
+			bool done;
+		};
+
+		struct Event
+		{
+			PusherCallback cb;		// NULL: a sync() marker
+			void* param;
+			RTSP_Pusher_State state;
+			int code;
+			SyncPoint* sync;
+		};
+
+		CallbackNotifier();
+		int start();
+		static void createInstance();
+		static void* threadProc(void* arg);
+		void run();
+		bool onNotifierThread() const;
+		// after whatever overflowed, if anything has
+		bool enqueue(const Event& e, bool mustDeliver);
+		// moves overflowed events to the queue while it has room; m_overflowLock held
+		void refill();
+
+	private:
+		Event* m_events;
+		RingQueue<Event> m_free;
+		RingQueue<Event> m_ready;
+		pthread_t m_tid;
+
+		pthread_mutex_t m_overflowLock;
+		std::deque<Event> m_overflow;
+		int m_numOverflow;		// m_overflow.size(), read without the lock
+
+		static CallbackNotifier* s_instance;
+		static pthread_once_t s_once;
+};
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file CpuFeatures.cpp
+ * @brief  CPU 向量指令集检测实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-16
+ */
+#include "CpuFeatures.h"
+#include <pthread.h>
+
+static pthread_once_t s_detectOnce = PTHREAD_ONCE_INIT;
+static CpuFeatures::Level s_detected = CpuFeatures::kScalar;
+static int s_limit = CpuFeatures::kAVX2;
+
+static void detect()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		s_detected = CpuFeatures::kAVX2;
+	else if (__builtin_cpu_supports("sse4.1"))
+		s_detected = CpuFeatures::kSSE41;
+	else if (__builtin_cpu_supports("sse2"))
+		s_detected = CpuFeatures::kSSE2;
+#endif
+}
+
+CpuFeatures::Level CpuFeatures::level()
+{
+	pthread_once(&s_detectOnce, detect);
+	int max = __atomic_load_n(&s_limit, __ATOMIC_RELAXED);
+	return (s_detected < max) ? s_detected : (Level) max;
+}
+
+void CpuFeatures::limit(Level max)
+{
+	__atomic_store_n(&s_limit, (int) max, __ATOMIC_RELAXED);
+}
+
+const char* CpuFeatures::name(Level level)
+{
+	switch (level)
+	{
+		case kSSE2:		return "sse2";
+		case kSSE41:	return "sse4.1";
+		case kAVX2:		return "avx2";
+		default:		return "scalar";
+	}
+}
@@ -0,0 +1,37 @@
+/**
+ * @file CpuFeatures.h
+ * @brief  运行时检测 CPU 的向量指令集, 供各编码/重采样实现选用 SIMD 实现
+ *
+ *	进程内只检测一次. 非 x86 或不是 GCC/Clang 编译时总是 kScalar.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-16
+ */
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+class CpuFeatures
+{
+	public:
+		// each level includes the ones before
+		enum Level
+		{
+			kScalar,
+			kSSE2,
+			kSSE41,
+			kAVX2
+		};
+
+		// The best the kernels may use: what the CPU has, detected on the
+		// first call, or less after limit().
+		static Level level();
+		// Caps level(), e.g. to check each kernel against the scalar one.
+		// The kernels pick up the change on their next call.
+		static void limit(Level max);
+
+		// "scalar", "sse2", "sse4.1" or "avx2"
+		static const char* name(Level level);
+};
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file FrameRing.cpp
+ * @brief  单生产者/单消费者帧队列实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-03
+ */
+#include "common.h"
+#include "FrameRing.h"
+#include <string.h>
+#include <fcntl.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+FrameRing::FrameRing()
+	: m_buf(NULL), m_capacity(0), m_mask(0), m_signalFd(-1), m_signalWriteFd(-1),
+	m_head(0), m_peekSize(0), m_tail(0), m_cachedHead(0), m_sleeping(1)
+{
+}
+
+FrameRing::~FrameRing()
+{
+	if (m_signalWriteFd >= 0 && m_signalWriteFd != m_signalFd) ::close(m_signalWriteFd);
+	if (m_signalFd >= 0) ::close(m_signalFd);
+	delete[] m_buf;
+}
+
+int FrameRing::init(uint32_t capacity)
+{
+	uint32_t cap = 1024;
+	while (cap < capacity) cap <<= 1;
+
+	m_buf = new char[cap];
+	if (m_buf == NULL) return -1;
+	m_capacity = cap;
+	m_mask = cap - 1;
+
+#if defined(__linux__)
+	m_signalFd = m_signalWriteFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+	if (m_signalFd < 0) return -1;
+#else
+	int fds[2];
+	if (::pipe(fds) != 0) return -1;
+	::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	m_signalFd = fds[0];
+	m_signalWriteFd = fds[1];
+#endif
+	return 0;
+}
+
+bool FrameRing::put(const MediaFrame* frame, int64_t enqueuedUs)
+{
+	uint32_t need = (sizeof(Record) + frame->frameLen + kAlign - 1) & ~(uint32_t)(kAlign - 1);
+	if (need > m_capacity / 2) return false;
+
+	uint64_t tail = m_tail;
+	uint32_t off = (uint32_t)tail & m_mask;
+	uint32_t toEnd = m_capacity - off;
+	uint32_t skip = (toEnd < need) ? toEnd : 0; // a record is never split
+
+	if (tail + skip + need - m_cachedHead > m_capacity)
+	{
+		m_cachedHead = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+		if (tail + skip + need - m_cachedHead > m_capacity)
+			return false;
+	}
+
+	if (skip > 0)
+	{
+		// records are 8 byte aligned, so there is room for these two fields
+		Record* r = (Record*)(m_buf + off);
+		r->size = skip;
+		r->frameLen = kWrap;
+		tail += skip;
+		off = 0;
+	}
+
+	Record* r = (Record*)(m_buf + off);
+	r->size = need;
+	r->frameLen = frame->frameLen;
+	r->timestampSec = frame->timestampSec;
+	r->timestampUsec = frame->timestampUsec;
+	r->duration = frame->duration;
+	r->enqueuedUs = enqueuedUs;
+	::memcpy(r + 1, frame->frameData, frame->frameLen);
+
+	__atomic_store_n(&m_tail, tail + need, __ATOMIC_RELEASE);
+	return true;
+}
+
+void FrameRing::notify()
+{
+	// a full barrier between publishing m_tail and looking at m_sleeping,
+	// paired with the one in idle(): either we see the consumer asleep, or
+	// it sees the new frame.
+	if (__atomic_exchange_n(&m_sleeping, 0, __ATOMIC_SEQ_CST))
+		signal();
+}
+
+void FrameRing::signal()
+{
+	uint64_t one = 1;
+	if (::write(m_signalWriteFd, &one, sizeof(one)) < 0)
+	{
+		// full means a wakeup is pending anyway
+	}
+}
+
+bool FrameRing::peek(MediaFrame& frame, int64_t* enqueuedUs)
+{
+	uint64_t tail = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+	if (m_head == tail) return false;
+
+	Record* r = (Record*)(m_buf + ((uint32_t)m_head & m_mask));
+	if (r->frameLen == kWrap)
+	{
+		__atomic_store_n(&m_head, m_head + r->size, __ATOMIC_RELEASE);
+		if (m_head == tail) return false;
+		r = (Record*)m_buf;
+	}
+
+	m_peekSize = r->size;
+	frame.frameLen = r->frameLen;
+	frame.frameData = (unsigned char*)(r + 1);
+	frame.timestampSec = r->timestampSec;
+	frame.timestampUsec = r->timestampUsec;
+	frame.duration = r->duration;
+	*enqueuedUs = r->enqueuedUs;
+	return true;
+}
+
+void FrameRing::pop()
+{
+	__atomic_store_n(&m_head, m_head + m_peekSize, __ATOMIC_RELEASE);
+	m_peekSize = 0;
+}
+
+bool FrameRing::idle()
+{
+	__atomic_store_n(&m_sleeping, 1, __ATOMIC_SEQ_CST);
+	return empty();
+}
+
+bool FrameRing::empty() const
+{
+	return m_head == __atomic_load_n(&m_tail, __ATOMIC_SEQ_CST);
+}
+
+void FrameRing::clearSignal()
+{
+	char buf[64];
+	while (::read(m_signalFd, buf, sizeof(buf)) > 0) {}
+}
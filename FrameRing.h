@@ -0,0 +1,86 @@
+/**
+ * @file FrameRing.h
+ * @brief  编码线程到网络线程的单生产者/单消费者帧队列
+ *
+ *	生产者(调用 PushFrame 的线程)把帧拷进环形缓冲后发布写位置, 不加锁、不等待;
+ *	只有消费者(推送流所属的事件循环线程)处于空闲时才通过 eventfd 唤醒它.
+ *	每帧在缓冲中连续存放, 消费者直接从缓冲发送, 不再拷贝.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-03
+ */
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdint.h>
+#include "API_PusherTypes.h"
+
+class FrameRing
+{
+	public:
+		enum { kDefaultCapacity = 64 * 1024 };
+
+		FrameRing();
+		~FrameRing();
+
+		// Rounds "capacity" up to a power of two. Returns -1 on failure.
+		int init(uint32_t capacity = kDefaultCapacity);
+
+		// Producer side. Copies the frame in, with the time it was handed
+		// over; returns false (and drops nothing already queued) if there
+		// is no room for it.
+		bool put(const MediaFrame* frame, int64_t enqueuedUs);
+		// Wakes the consumer up if it is waiting for frames.
+		void notify();
+
+		// Consumer side. "frame" points into the ring until pop().
+		bool peek(MediaFrame& frame, int64_t* enqueuedUs);
+		void pop();
+		// Call once drained: returns true if the ring is still empty, i.e. it
+		// is fine to wait for the signal fd; false if more has come in.
+		bool idle();
+
+		// readable once notify() was called; clearSignal() resets it
+		int signalFd() const { return m_signalFd; }
+		void signal();	// unconditionally, e.g. to come back to what's left
+		void clearSignal();
+
+	private:
+		struct Record
+		{
+			uint32_t size;		// of the whole record, header and padding included
+			uint32_t frameLen;	// kWrap: skip to the start of the buffer
+			uint32_t timestampSec;
+			uint32_t timestampUsec;
+			double duration;
+			int64_t enqueuedUs;
+		};
+		enum { kWrap = 0xFFFFFFFF, kAlign = 8, kCacheLine = 64 };
+
+		bool empty() const;
+
+	private:
+		char* m_buf;
+		uint32_t m_capacity;
+		uint32_t m_mask;
+		int m_signalFd;
+		int m_signalWriteFd;	// same as m_signalFd for an eventfd
+
+		// consumer owned
+		char m_pad0[kCacheLine];
+		uint64_t volatile m_head;
+		uint32_t m_peekSize;
+
+		// producer owned
+		char m_pad1[kCacheLine];
+		uint64_t volatile m_tail;
+		uint64_t m_cachedHead;	// the producer's last look at m_head
+
+		// set by the consumer before it waits, cleared by whoever wakes it
+		char m_pad2[kCacheLine];
+		int volatile m_sleeping;
+		char m_pad3[kCacheLine];
+};
+
+#endif
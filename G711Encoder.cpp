@@ -0,0 +1,277 @@
+/**
+ * @file G711Encoder.cpp
+ * @brief  G.711 编码实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-11
+ */
+#include "G711Encoder.h"
+#include "CpuFeatures.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define G711_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+typedef void (*EncodeProc)(const int16_t* pcm, uint8_t* out, size_t n);
+
+// The reference: the top 14 (μ-law) or 13 (A-law) bits of the sample,
+// biased for μ-law, then a 3 bit segment and a 4 bit step, inverted.
+
+static inline uint8_t linearToULaw(int16_t sample)
+{
+	static const int segEnd[8] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+
+	int val = sample >> 2;
+	int mask = 0xFF;
+	if (val < 0)
+	{
+		val = -val;
+		mask = 0x7F;
+	}
+	if (val > 8159) val = 8159;
+	val += 0x21;
+
+	int seg = 0;
+	while (seg < 8 && val > segEnd[seg]) seg++;
+	if (seg >= 8) return (uint8_t) (0x7F ^ mask);
+	return (uint8_t) (((seg << 4) | ((val >> (seg + 1)) & 0x0F)) ^ mask);
+}
+
+static inline uint8_t linearToALaw(int16_t sample)
+{
+	static const int segEnd[8] = { 0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF };
+
+	int val = sample >> 3;
+	int mask = 0xD5;
+	if (val < 0)
+	{
+		val = -val - 1;
+		mask = 0x55;
+	}
+
+	int seg = 0;
+	while (seg < 8 && val > segEnd[seg]) seg++;
+	if (seg >= 8) return (uint8_t) (0x7F ^ mask);
+	int step = (seg < 2) ? (val >> 1) : (val >> seg);
+	return (uint8_t) (((seg << 4) | (step & 0x0F)) ^ mask);
+}
+
+static void encodeULawScalar(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = linearToULaw(pcm[i]);
+}
+
+static void encodeALawScalar(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = linearToALaw(pcm[i]);
+}
+
+#ifdef G711_X86_KERNELS
+
+// Vectors of 16 bit lanes. The segment is the count of segment ends the
+// value is above; the per-lane shift by the segment is a high multiply by
+// a power of two looked up with pshufb (bit 15 of the index: a zero byte).
+// The μ-law value is clamped to 0x1FFF rather than 8159 + 0x21: both
+// encode to the top code.
+
+__attribute__((target("sse4.1")))
+static inline __m128i ulaw8(__m128i s)
+{
+	const __m128i shifts = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+			0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m128i x = _mm_srai_epi16(s, 2);
+	__m128i neg = _mm_srai_epi16(x, 15);
+	__m128i v = _mm_min_epi16(_mm_add_epi16(_mm_abs_epi16(x), _mm_set1_epi16(0x21)), _mm_set1_epi16(0x1FFF));
+
+	__m128i seg = _mm_setzero_si128();
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x3F)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x7F)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0xFF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x1FF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x3FF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x7FF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0xFFF)));
+
+	__m128i mul = _mm_slli_epi16(_mm_shuffle_epi8(shifts, _mm_or_si128(seg, _mm_set1_epi16((short)0x8000))), 8);
+	__m128i step = _mm_and_si128(_mm_mulhi_epu16(v, mul), _mm_set1_epi16(0x0F));
+	__m128i mask = _mm_xor_si128(_mm_set1_epi16(0xFF), _mm_and_si128(neg, _mm_set1_epi16(0x80)));
+	return _mm_xor_si128(_mm_or_si128(_mm_slli_epi16(seg, 4), step), mask);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i alaw8(__m128i s)
+{
+	const __m128i shifts = _mm_setr_epi8((char)0x80, (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
+			0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m128i x = _mm_srai_epi16(s, 3);
+	__m128i neg = _mm_srai_epi16(x, 15);
+	__m128i v = _mm_xor_si128(x, neg);	// -x - 1 below zero
+
+	__m128i seg = _mm_setzero_si128();
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x1F)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x3F)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x7F)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0xFF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x1FF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x3FF)));
+	seg = _mm_sub_epi16(seg, _mm_cmpgt_epi16(v, _mm_set1_epi16(0x7FF)));
+
+	__m128i mul = _mm_slli_epi16(_mm_shuffle_epi8(shifts, _mm_or_si128(seg, _mm_set1_epi16((short)0x8000))), 8);
+	__m128i step = _mm_and_si128(_mm_mulhi_epu16(v, mul), _mm_set1_epi16(0x0F));
+	__m128i mask = _mm_xor_si128(_mm_set1_epi16(0xD5), _mm_and_si128(neg, _mm_set1_epi16(0x80)));
+	return _mm_xor_si128(_mm_or_si128(_mm_slli_epi16(seg, 4), step), mask);
+}
+
+__attribute__((target("sse4.1")))
+static void encodeULawSSE41(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i a = ulaw8(_mm_loadu_si128((const __m128i*) (pcm + i)));
+		__m128i b = ulaw8(_mm_loadu_si128((const __m128i*) (pcm + i + 8)));
+		_mm_storeu_si128((__m128i*) (out + i), _mm_packus_epi16(a, b));
+	}
+	encodeULawScalar(pcm + i, out + i, n - i);
+}
+
+__attribute__((target("sse4.1")))
+static void encodeALawSSE41(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i a = alaw8(_mm_loadu_si128((const __m128i*) (pcm + i)));
+		__m128i b = alaw8(_mm_loadu_si128((const __m128i*) (pcm + i + 8)));
+		_mm_storeu_si128((__m128i*) (out + i), _mm_packus_epi16(a, b));
+	}
+	encodeALawScalar(pcm + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ulaw16(__m256i s)
+{
+	const __m256i shifts = _mm256_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			(char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+			0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m256i x = _mm256_srai_epi16(s, 2);
+	__m256i neg = _mm256_srai_epi16(x, 15);
+	__m256i v = _mm256_min_epi16(_mm256_add_epi16(_mm256_abs_epi16(x), _mm256_set1_epi16(0x21)),
+			_mm256_set1_epi16(0x1FFF));
+
+	__m256i seg = _mm256_setzero_si256();
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x3F)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7F)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0xFF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x1FF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x3FF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7FF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0xFFF)));
+
+	__m256i mul = _mm256_slli_epi16(_mm256_shuffle_epi8(shifts,
+			_mm256_or_si256(seg, _mm256_set1_epi16((short)0x8000))), 8);
+	__m256i step = _mm256_and_si256(_mm256_mulhi_epu16(v, mul), _mm256_set1_epi16(0x0F));
+	__m256i mask = _mm256_xor_si256(_mm256_set1_epi16(0xFF), _mm256_and_si256(neg, _mm256_set1_epi16(0x80)));
+	return _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi16(seg, 4), step), mask);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i alaw16(__m256i s)
+{
+	const __m256i shifts = _mm256_setr_epi8((char)0x80, (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			(char)0x80, (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
+			0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m256i x = _mm256_srai_epi16(s, 3);
+	__m256i neg = _mm256_srai_epi16(x, 15);
+	__m256i v = _mm256_xor_si256(x, neg);
+
+	__m256i seg = _mm256_setzero_si256();
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x1F)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x3F)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7F)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0xFF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x1FF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x3FF)));
+	seg = _mm256_sub_epi16(seg, _mm256_cmpgt_epi16(v, _mm256_set1_epi16(0x7FF)));
+
+	__m256i mul = _mm256_slli_epi16(_mm256_shuffle_epi8(shifts,
+			_mm256_or_si256(seg, _mm256_set1_epi16((short)0x8000))), 8);
+	__m256i step = _mm256_and_si256(_mm256_mulhi_epu16(v, mul), _mm256_set1_epi16(0x0F));
+	__m256i mask = _mm256_xor_si256(_mm256_set1_epi16(0xD5), _mm256_and_si256(neg, _mm256_set1_epi16(0x80)));
+	return _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi16(seg, 4), step), mask);
+}
+
+// packus works within 128 bit lanes: put the quarters back in order
+__attribute__((target("avx2")))
+static void encodeULawAVX2(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i a = ulaw16(_mm256_loadu_si256((const __m256i*) (pcm + i)));
+		__m256i b = ulaw16(_mm256_loadu_si256((const __m256i*) (pcm + i + 16)));
+		__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+		_mm256_storeu_si256((__m256i*) (out + i), r);
+	}
+	encodeULawSSE41(pcm + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void encodeALawAVX2(const int16_t* pcm, uint8_t* out, size_t n)
+{
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32)
+	{
+		__m256i a = alaw16(_mm256_loadu_si256((const __m256i*) (pcm + i)));
+		__m256i b = alaw16(_mm256_loadu_si256((const __m256i*) (pcm + i + 16)));
+		__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+		_mm256_storeu_si256((__m256i*) (out + i), r);
+	}
+	encodeALawSSE41(pcm + i, out + i, n - i);
+}
+
+#endif
+
+struct Kernels
+{
+	EncodeProc ulaw;
+	EncodeProc alaw;
+	const char* name;
+};
+
+static const Kernels& kernels()
+{
+	static const Kernels scalar = { encodeULawScalar, encodeALawScalar, "scalar" };
+#ifdef G711_X86_KERNELS
+	static const Kernels sse41 = { encodeULawSSE41, encodeALawSSE41, "sse4.1" };
+	static const Kernels avx2 = { encodeULawAVX2, encodeALawAVX2, "avx2" };
+
+	CpuFeatures::Level level = CpuFeatures::level();
+	if (level >= CpuFeatures::kAVX2) return avx2;
+	if (level >= CpuFeatures::kSSE41) return sse41;
+#endif
+	return scalar;
+}
+
+void G711Encoder::encode(Law law, const int16_t* pcm, uint8_t* out, size_t n)
+{
+	const Kernels& k = kernels();
+	if (law == kULaw)
+		k.ulaw(pcm, out, n);
+	else
+		k.alaw(pcm, out, n);
+}
+
+const char* G711Encoder::kernelName()
+{
+	return kernels().name;
+}
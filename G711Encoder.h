@@ -0,0 +1,33 @@
+/**
+ * @file G711Encoder.h
+ * @brief  16 位线性 PCM 编码为 G.711 μ-law / A-law
+ *
+ *	与 ITU-T G.711 参考实现(Sun g711.c)逐字节一致. x86 上按 CPU 支持选用
+ *	AVX2 或 SSE4.1 的向量实现, 一次编码 32 或 16 个采样, 其余平台用标量实现.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-11
+ */
+#ifndef G711_ENCODER_H
+#define G711_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class G711Encoder
+{
+	public:
+		enum Law
+		{
+			kULaw,		// PCMU
+			kALaw		// PCMA
+		};
+
+		// "n" samples of 16 bit linear PCM to as many G.711 bytes.
+		static void encode(Law law, const int16_t* pcm, uint8_t* out, size_t n);
+		// the kernels encode() runs: "avx2", "sse4.1" or "scalar"
+		static const char* kernelName();
+};
+
+#endif
@@ -0,0 +1,356 @@
+/**
+ * @file ImaAdpcmEncoder.cpp
+ * @brief  IMA ADPCM 编码实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-14
+ */
+#include "ImaAdpcmEncoder.h"
+#include "CpuFeatures.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADPCM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+enum
+{
+	kLanes		= 16,	// streams per pass of a kernel
+	kBlock		= 16	// samples per stream moved in and out at a time
+};
+
+static const int kIndexTable[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static const int kStepTable[ImaAdpcmEncoder::kMaxIndex + 1] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static inline void decodeNibble(ImaAdpcmEncoder::State& st, int code)
+{
+	int step = kStepTable[st.index];
+	int diff = step >> 3;
+	if (code & 4) diff += step;
+	if (code & 2) diff += step >> 1;
+	if (code & 1) diff += step >> 2;
+
+	st.predictor += (code & 8) ? -diff : diff;
+	if (st.predictor > 32767) st.predictor = 32767;
+	else if (st.predictor < -32768) st.predictor = -32768;
+
+	st.index += kIndexTable[code & 7];
+	if (st.index < 0) st.index = 0;
+	else if (st.index > ImaAdpcmEncoder::kMaxIndex) st.index = ImaAdpcmEncoder::kMaxIndex;
+}
+
+// the code for "sample", moving the state the way the decoder will
+static inline int encodeSample(ImaAdpcmEncoder::State& st, int sample)
+{
+	int step = kStepTable[st.index];
+	int diff = sample - st.predictor;
+	int code = 0;
+	if (diff < 0)
+	{
+		code = 8;
+		diff = -diff;
+	}
+	if (diff >= step)
+	{
+		code |= 4;
+		diff -= step;
+	}
+	if (diff >= (step >> 1))
+	{
+		code |= 2;
+		diff -= step >> 1;
+	}
+	if (diff >= (step >> 2))
+		code |= 1;
+
+	decodeNibble(st, code);
+	return code;
+}
+
+// A kernel encodes "pairs" pairs of samples of kLanes streams: pcm[j][lane]
+// to codes[j / 2][lane], the state in pred[lane] and index[lane].
+typedef void (*BlockProc)(int16_t* pred, int16_t* index, const int16_t (*pcm)[kLanes],
+		uint8_t (*codes)[kLanes], int pairs);
+
+#ifdef ADPCM_X86_KERNELS
+
+// Lanes of 16 bits. |sample - predictor| may need all 16 bits, so it is
+// kept unsigned and compared with max_epu16. The predictor moves by up to
+// four terms of the same sign, each below 32768: adding them one by one
+// with saturation clamps the same as adding the sum. The index steps come
+// from pshufb, offset by one to stay positive.
+
+// the AVX2 kernel gathers 32-bit steps straight from kStepTable
+typedef char IntIs32Bits[(sizeof(int) == 4) ? 1 : -1];
+
+__attribute__((target("sse4.1")))
+static inline __m128i stepOf8(__m128i index)
+{
+	int16_t idx[8];
+	_mm_storeu_si128((__m128i*) idx, index);
+	return _mm_setr_epi16(kStepTable[idx[0]], kStepTable[idx[1]], kStepTable[idx[2]], kStepTable[idx[3]],
+			kStepTable[idx[4]], kStepTable[idx[5]], kStepTable[idx[6]], kStepTable[idx[7]]);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i encode8(__m128i sample, __m128i& pred, __m128i& index)
+{
+	const __m128i indexSteps = _mm_setr_epi8(0, 0, 0, 0, 3, 5, 7, 9, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m128i step = stepOf8(index);
+	__m128i neg = _mm_cmpgt_epi16(pred, sample);
+	__m128i diff = _mm_sub_epi16(_mm_max_epi16(sample, pred), _mm_min_epi16(sample, pred));
+
+	__m128i t0 = _mm_srli_epi16(step, 3);
+	__m128i ge = _mm_cmpeq_epi16(_mm_max_epu16(diff, step), diff);
+	__m128i t1 = _mm_and_si128(ge, step);
+	__m128i code = _mm_and_si128(ge, _mm_set1_epi16(4));
+	diff = _mm_sub_epi16(diff, t1);
+
+	__m128i half = _mm_srli_epi16(step, 1);
+	ge = _mm_cmpeq_epi16(_mm_max_epu16(diff, half), diff);
+	__m128i t2 = _mm_and_si128(ge, half);
+	code = _mm_or_si128(code, _mm_and_si128(ge, _mm_set1_epi16(2)));
+	diff = _mm_sub_epi16(diff, t2);
+
+	__m128i quarter = _mm_srli_epi16(step, 2);
+	ge = _mm_cmpeq_epi16(_mm_max_epu16(diff, quarter), diff);
+	__m128i t3 = _mm_and_si128(ge, quarter);
+	code = _mm_or_si128(code, _mm_and_si128(ge, _mm_set1_epi16(1)));
+
+	pred = _mm_adds_epi16(pred, _mm_sub_epi16(_mm_xor_si128(t0, neg), neg));
+	pred = _mm_adds_epi16(pred, _mm_sub_epi16(_mm_xor_si128(t1, neg), neg));
+	pred = _mm_adds_epi16(pred, _mm_sub_epi16(_mm_xor_si128(t2, neg), neg));
+	pred = _mm_adds_epi16(pred, _mm_sub_epi16(_mm_xor_si128(t3, neg), neg));
+
+	__m128i adj = _mm_shuffle_epi8(indexSteps, _mm_or_si128(code, _mm_set1_epi16((short)0x8000)));
+	index = _mm_add_epi16(index, _mm_sub_epi16(adj, _mm_set1_epi16(1)));
+	index = _mm_min_epi16(_mm_max_epi16(index, _mm_setzero_si128()), _mm_set1_epi16(ImaAdpcmEncoder::kMaxIndex));
+
+	return _mm_or_si128(code, _mm_and_si128(neg, _mm_set1_epi16(8)));
+}
+
+// two vectors of 8 lanes, side by side
+__attribute__((target("sse4.1")))
+static void encodeBlockSSE41(int16_t* pred, int16_t* index, const int16_t (*pcm)[kLanes],
+		uint8_t (*codes)[kLanes], int pairs)
+{
+	__m128i predA = _mm_loadu_si128((const __m128i*) pred);
+	__m128i predB = _mm_loadu_si128((const __m128i*) (pred + 8));
+	__m128i indexA = _mm_loadu_si128((const __m128i*) index);
+	__m128i indexB = _mm_loadu_si128((const __m128i*) (index + 8));
+
+	for (int k = 0; k < pairs; k++)
+	{
+		const int16_t* s0 = pcm[2 * k];
+		const int16_t* s1 = pcm[2 * k + 1];
+		__m128i hiA = encode8(_mm_loadu_si128((const __m128i*) s0), predA, indexA);
+		__m128i hiB = encode8(_mm_loadu_si128((const __m128i*) (s0 + 8)), predB, indexB);
+		__m128i loA = encode8(_mm_loadu_si128((const __m128i*) s1), predA, indexA);
+		__m128i loB = encode8(_mm_loadu_si128((const __m128i*) (s1 + 8)), predB, indexB);
+
+		__m128i a = _mm_or_si128(_mm_slli_epi16(hiA, 4), loA);
+		__m128i b = _mm_or_si128(_mm_slli_epi16(hiB, 4), loB);
+		_mm_storeu_si128((__m128i*) codes[k], _mm_packus_epi16(a, b));
+	}
+
+	_mm_storeu_si128((__m128i*) pred, predA);
+	_mm_storeu_si128((__m128i*) (pred + 8), predB);
+	_mm_storeu_si128((__m128i*) index, indexA);
+	_mm_storeu_si128((__m128i*) (index + 8), indexB);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i stepOf16(__m256i index)
+{
+	__m256i lo = _mm256_i32gather_epi32(kStepTable, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(index)), 4);
+	__m256i hi = _mm256_i32gather_epi32(kStepTable, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(index, 1)), 4);
+	return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i encode16(__m256i sample, __m256i& pred, __m256i& index)
+{
+	const __m256i indexSteps = _mm256_setr_epi8(0, 0, 0, 0, 3, 5, 7, 9, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 3, 5, 7, 9, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	__m256i step = stepOf16(index);
+	__m256i neg = _mm256_cmpgt_epi16(pred, sample);
+	__m256i diff = _mm256_sub_epi16(_mm256_max_epi16(sample, pred), _mm256_min_epi16(sample, pred));
+
+	__m256i t0 = _mm256_srli_epi16(step, 3);
+	__m256i ge = _mm256_cmpeq_epi16(_mm256_max_epu16(diff, step), diff);
+	__m256i t1 = _mm256_and_si256(ge, step);
+	__m256i code = _mm256_and_si256(ge, _mm256_set1_epi16(4));
+	diff = _mm256_sub_epi16(diff, t1);
+
+	__m256i half = _mm256_srli_epi16(step, 1);
+	ge = _mm256_cmpeq_epi16(_mm256_max_epu16(diff, half), diff);
+	__m256i t2 = _mm256_and_si256(ge, half);
+	code = _mm256_or_si256(code, _mm256_and_si256(ge, _mm256_set1_epi16(2)));
+	diff = _mm256_sub_epi16(diff, t2);
+
+	__m256i quarter = _mm256_srli_epi16(step, 2);
+	ge = _mm256_cmpeq_epi16(_mm256_max_epu16(diff, quarter), diff);
+	__m256i t3 = _mm256_and_si256(ge, quarter);
+	code = _mm256_or_si256(code, _mm256_and_si256(ge, _mm256_set1_epi16(1)));
+
+	pred = _mm256_adds_epi16(pred, _mm256_sub_epi16(_mm256_xor_si256(t0, neg), neg));
+	pred = _mm256_adds_epi16(pred, _mm256_sub_epi16(_mm256_xor_si256(t1, neg), neg));
+	pred = _mm256_adds_epi16(pred, _mm256_sub_epi16(_mm256_xor_si256(t2, neg), neg));
+	pred = _mm256_adds_epi16(pred, _mm256_sub_epi16(_mm256_xor_si256(t3, neg), neg));
+
+	__m256i adj = _mm256_shuffle_epi8(indexSteps, _mm256_or_si256(code, _mm256_set1_epi16((short)0x8000)));
+	index = _mm256_add_epi16(index, _mm256_sub_epi16(adj, _mm256_set1_epi16(1)));
+	index = _mm256_min_epi16(_mm256_max_epi16(index, _mm256_setzero_si256()),
+			_mm256_set1_epi16(ImaAdpcmEncoder::kMaxIndex));
+
+	return _mm256_or_si256(code, _mm256_and_si256(neg, _mm256_set1_epi16(8)));
+}
+
+__attribute__((target("avx2")))
+static void encodeBlockAVX2(int16_t* pred, int16_t* index, const int16_t (*pcm)[kLanes],
+		uint8_t (*codes)[kLanes], int pairs)
+{
+	__m256i p = _mm256_loadu_si256((const __m256i*) pred);
+	__m256i x = _mm256_loadu_si256((const __m256i*) index);
+
+	for (int k = 0; k < pairs; k++)
+	{
+		__m256i hi = encode16(_mm256_loadu_si256((const __m256i*) pcm[2 * k]), p, x);
+		__m256i lo = encode16(_mm256_loadu_si256((const __m256i*) pcm[2 * k + 1]), p, x);
+		__m256i b = _mm256_or_si256(_mm256_slli_epi16(hi, 4), lo);
+		_mm_storeu_si128((__m128i*) codes[k],
+				_mm_packus_epi16(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1)));
+	}
+
+	_mm256_storeu_si256((__m256i*) pred, p);
+	_mm256_storeu_si256((__m256i*) index, x);
+}
+
+#endif
+
+struct Kernels
+{
+	BlockProc encodeBlock;	// NULL: a stream at a time
+	const char* name;
+};
+
+static const Kernels& kernels()
+{
+	static const Kernels scalar = { NULL, "scalar" };
+#ifdef ADPCM_X86_KERNELS
+	static const Kernels sse41 = { encodeBlockSSE41, "sse4.1" };
+	static const Kernels avx2 = { encodeBlockAVX2, "avx2" };
+
+	CpuFeatures::Level level = CpuFeatures::level();
+	if (level >= CpuFeatures::kAVX2) return avx2;
+	if (level >= CpuFeatures::kSSE41) return sse41;
+#endif
+	return scalar;
+}
+
+void ImaAdpcmEncoder::encode(State& state, const int16_t* pcm, uint8_t* out, size_t n)
+{
+	for (size_t i = 0; i + 1 < n; i += 2)
+	{
+		int hi = encodeSample(state, pcm[i]);
+		int lo = encodeSample(state, pcm[i + 1]);
+		out[i / 2] = (uint8_t) ((hi << 4) | lo);
+	}
+}
+
+void ImaAdpcmEncoder::encodeStreams(State* const* states, const int16_t* const* pcm, uint8_t* const* out,
+		int count, size_t n)
+{
+	BlockProc encodeBlock = kernels().encodeBlock;
+
+	for (int base = 0; base < count; base += kLanes)
+	{
+		int lanes = (count - base < kLanes) ? (count - base) : (int) kLanes;
+		size_t done = 0;
+
+		if (encodeBlock != NULL && lanes > 1)
+		{
+			// lanes past the last stream encode silence
+			int16_t pred[kLanes] = { 0 };
+			int16_t index[kLanes] = { 0 };
+			int16_t in[kBlock][kLanes];
+			uint8_t codes[kBlock / 2][kLanes];
+			::memset(in, 0, sizeof(in));
+
+			for (int s = 0; s < lanes; s++)
+			{
+				pred[s] = (int16_t) states[base + s]->predictor;
+				index[s] = (int16_t) states[base + s]->index;
+			}
+			for (; done + kBlock <= n; done += kBlock)
+			{
+				for (int s = 0; s < lanes; s++)
+				{
+					const int16_t* p = pcm[base + s] + done;
+					for (int j = 0; j < kBlock; j++)
+						in[j][s] = p[j];
+				}
+				encodeBlock(pred, index, in, codes, kBlock / 2);
+				for (int s = 0; s < lanes; s++)
+				{
+					uint8_t* o = out[base + s] + done / 2;
+					for (int k = 0; k < kBlock / 2; k++)
+						o[k] = codes[k][s];
+				}
+			}
+			for (int s = 0; s < lanes; s++)
+			{
+				states[base + s]->predictor = pred[s];
+				states[base + s]->index = index[s];
+			}
+		}
+
+		for (int s = 0; s < lanes; s++)
+			encode(*states[base + s], pcm[base + s] + done, out[base + s] + done / 2, n - done);
+	}
+}
+
+void ImaAdpcmEncoder::advance(State& state, const uint8_t* data, size_t bytes)
+{
+	for (size_t i = 0; i < bytes; i++)
+	{
+		decodeNibble(state, data[i] >> 4);
+		decodeNibble(state, data[i] & 0x0F);
+	}
+}
+
+void ImaAdpcmEncoder::writeHeader(const State& state, uint8_t* hdr)
+{
+	hdr[0] = (uint8_t) (state.predictor >> 8);
+	hdr[1] = (uint8_t) state.predictor;
+	hdr[2] = (uint8_t) state.index;
+	hdr[3] = 0;
+}
+
+bool ImaAdpcmEncoder::readHeader(const uint8_t* hdr, State& state)
+{
+	if (hdr[2] > kMaxIndex) return false;
+	state.predictor = (int16_t) ((hdr[0] << 8) | hdr[1]);
+	state.index = hdr[2];
+	return true;
+}
+
+const char* ImaAdpcmEncoder::kernelName()
+{
+	return kernels().name;
+}
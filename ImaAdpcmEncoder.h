@@ -0,0 +1,50 @@
+/**
+ * @file ImaAdpcmEncoder.h
+ * @brief  16 位线性 PCM 编码为 IMA ADPCM(RTP 的 DVI4, RFC 3551)
+ *
+ *	每个采样编为 4 位, 一个字节两个采样, 先编的在高 4 位. 编码状态为预测值和步长索引,
+ *	即 DVI4 头的内容. 单个流的编码是串行的, 所以向量化在流之间进行: 多个流
+ *	一起编码, 每个流占一个 SIMD 通道(AVX2 一次 16 个流, SSE4.1 一次 8 个).
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-14
+ */
+#ifndef IMA_ADPCM_ENCODER_H
+#define IMA_ADPCM_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class ImaAdpcmEncoder
+{
+	public:
+		enum
+		{
+			kHeaderSize		= 4,	// DVI4: predictor (16 bit), step index, 0
+			kMaxIndex		= 88
+		};
+
+		struct State
+		{
+			int predictor;
+			int index;
+		};
+
+		// "n" samples, an even number, into n / 2 bytes.
+		static void encode(State& state, const int16_t* pcm, uint8_t* out, size_t n);
+		// "count" streams of "n" samples each (n even), a SIMD lane each.
+		static void encodeStreams(State* const* states, const int16_t* const* pcm, uint8_t* const* out,
+				int count, size_t n);
+		// The decoder's side: "state" after "bytes" of encoded samples.
+		static void advance(State& state, const uint8_t* data, size_t bytes);
+
+		static void writeHeader(const State& state, uint8_t* hdr);
+		// false if the step index is out of range
+		static bool readHeader(const uint8_t* hdr, State& state);
+
+		// the kernels encodeStreams() runs: "avx2", "sse4.1" or "scalar"
+		static const char* kernelName();
+};
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * @file IoUringSender.cpp
+ * @brief  io_uring 发送后端实现, 直接使用系统调用(不依赖 liburing)
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-17
+ */
+#include "common.h"
+#include "IoUringSender.h"
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+
+#define CANCEL_USER_DATA	0xFFFFFFFFFFFFFFFFULL
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+	return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nrArgs)
+{
+	return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs);
+}
+
+IoUringSender* IoUringSender::createNew(TaskScheduler& scheduler, uint32_t numBuffers, uint32_t bufferSize)
+{
+	IoUringSender* sender = new IoUringSender(scheduler);
+	if (sender != NULL && sender->init(numBuffers, bufferSize) != 0)
+	{
+		delete sender;
+		return NULL;
+	}
+	return sender;
+}
+
+IoUringSender::IoUringSender(TaskScheduler& scheduler)
+	: m_scheduler(scheduler), m_ringFd(-1), m_eventFd(-1), m_fixedBuffers(false),
+	m_sqRing(MAP_FAILED), m_sqRingSize(0), m_cqRing(MAP_FAILED), m_cqRingSize(0),
+	m_sqes((struct io_uring_sqe*) MAP_FAILED), m_sqesSize(0),
+	m_sqTail(NULL), m_sqHead(NULL), m_sqMask(0), m_sqArray(NULL),
+	m_cqHead(NULL), m_cqTail(NULL), m_cqMask(0), m_cqes(NULL), m_toSubmit(0),
+	m_pool((char*) MAP_FAILED), m_numBuffers(0), m_bufferSize(0)
+{
+}
+
+IoUringSender::~IoUringSender()
+{
+	if (m_eventFd >= 0)
+	{
+		m_scheduler.disableBackgroundHandling(m_eventFd);
+		::close(m_eventFd);
+	}
+	// closing the ring cancels whatever is still in flight
+	if (m_ringFd >= 0) ::close(m_ringFd);
+
+	if (m_sqes != MAP_FAILED) ::munmap(m_sqes, m_sqesSize);
+	if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing) ::munmap(m_cqRing, m_cqRingSize);
+	if (m_sqRing != MAP_FAILED) ::munmap(m_sqRing, m_sqRingSize);
+	if (m_pool != MAP_FAILED) ::munmap(m_pool, (size_t)m_numBuffers * m_bufferSize);
+}
+
+int IoUringSender::init(uint32_t numBuffers, uint32_t bufferSize)
+{
+	// a poll and a write per buffer at most, plus the cancellations
+	struct io_uring_params p;
+	::memset(&p, 0, sizeof(p));
+	m_ringFd = sys_io_uring_setup(numBuffers * 2 + 8, &p);
+	if (m_ringFd < 0) return -1;
+
+	m_sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	m_cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (m_cqRingSize > m_sqRingSize) m_sqRingSize = m_cqRingSize;
+		m_cqRingSize = m_sqRingSize;
+	}
+
+	m_sqRing = ::mmap(NULL, m_sqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+			m_ringFd, IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED) return -1;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		m_cqRing = m_sqRing;
+	}
+	else
+	{
+		m_cqRing = ::mmap(NULL, m_cqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+				m_ringFd, IORING_OFF_CQ_RING);
+		if (m_cqRing == MAP_FAILED) return -1;
+	}
+
+	m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	m_sqes = (struct io_uring_sqe*) ::mmap(NULL, m_sqesSize, PROT_READ|PROT_WRITE,
+			MAP_SHARED|MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+	if (m_sqes == MAP_FAILED) return -1;
+
+	char* sq = (char*) m_sqRing;
+	m_sqHead = (unsigned*)(sq + p.sq_off.head);
+	m_sqTail = (unsigned*)(sq + p.sq_off.tail);
+	m_sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+	m_sqArray = (unsigned*)(sq + p.sq_off.array);
+
+	char* cq = (char*) m_cqRing;
+	m_cqHead = (unsigned*)(cq + p.cq_off.head);
+	m_cqTail = (unsigned*)(cq + p.cq_off.tail);
+	m_cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+	m_cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	// the packet pool: page aligned, registered once so that the kernel
+	// doesn't map the pages in for every write
+	m_pool = (char*) ::mmap(NULL, (size_t)numBuffers * bufferSize, PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (m_pool == MAP_FAILED) return -1;
+	m_numBuffers = numBuffers;
+	m_bufferSize = bufferSize;
+
+	std::vector<struct iovec> iov(numBuffers);
+	for (uint32_t i = 0; i < numBuffers; i++)
+	{
+		iov[i].iov_base = buffer(i);
+		iov[i].iov_len = bufferSize;
+	}
+	// may fail on the locked memory limit: plain writes from the pool then
+	m_fixedBuffers = (sys_io_uring_register(m_ringFd, IORING_REGISTER_BUFFERS, &iov[0], numBuffers) == 0);
+
+	m_eventFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+	if (m_eventFd < 0) return -1;
+	if (sys_io_uring_register(m_ringFd, IORING_REGISTER_EVENTFD, &m_eventFd, 1) != 0) return -1;
+	m_scheduler.setBackgroundHandling(m_eventFd, SOCKET_READABLE,
+			(TaskScheduler::BackgroundHandlerProc*) &completionHandler, this);
+
+	m_slots.resize(numBuffers);
+	m_freeSlots.reserve(numBuffers);
+	for (uint32_t i = numBuffers; i > 0; i--)
+		m_freeSlots.push_back(i - 1);
+	return 0;
+}
+
+int IoUringSender::acquireBuffer()
+{
+	if (m_freeSlots.empty()) return -1;
+	int slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	return slot;
+}
+
+void IoUringSender::releaseBuffer(int slot)
+{
+	m_slots[slot].proc = NULL;
+	m_slots[slot].clientData = NULL;
+	m_freeSlots.push_back(slot);
+}
+
+struct io_uring_sqe* IoUringSender::getSqe()
+{
+	// room is guaranteed: the ring has two entries per buffer
+	unsigned tail = *m_sqTail + m_toSubmit;
+	unsigned idx = tail & m_sqMask;
+	struct io_uring_sqe* sqe = &m_sqes[idx];
+	::memset(sqe, 0, sizeof(*sqe));
+	m_sqArray[idx] = idx;
+	m_toSubmit++;
+	return sqe;
+}
+
+void IoUringSender::queueWrite(int slot, int fd, uint32_t len, CompletionProc* proc, void* clientData)
+{
+	Slot& s = m_slots[slot];
+	s.fd = fd;
+	s.len = len;
+	s.sent = 0;
+	s.proc = proc;
+	s.clientData = clientData;
+	queueRest(slot, false);
+}
+
+void IoUringSender::queueRest(int slot, bool waitWritable)
+{
+	Slot& s = m_slots[slot];
+
+	if (waitWritable)
+	{
+		// the write only starts once the socket has room again
+		struct io_uring_sqe* poll = getSqe();
+		poll->opcode = IORING_OP_POLL_ADD;
+		poll->fd = s.fd;
+		poll->poll_events = POLLOUT;
+		poll->flags = IOSQE_IO_LINK;
+		poll->user_data = (uint64_t)slot | kPollFlag;
+	}
+
+	struct io_uring_sqe* sqe = getSqe();
+	sqe->opcode = m_fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	sqe->fd = s.fd;
+	sqe->addr = (uint64_t)(uintptr_t)(buffer(slot) + s.sent);
+	sqe->len = s.len - s.sent;
+	sqe->off = 0;
+	sqe->buf_index = (uint16_t)slot;
+	sqe->user_data = (uint64_t)slot;
+}
+
+void IoUringSender::submit()
+{
+	if (m_toSubmit == 0) return;
+
+	__atomic_store_n(m_sqTail, *m_sqTail + m_toSubmit, __ATOMIC_RELEASE);
+	unsigned toSubmit = m_toSubmit;
+	m_toSubmit = 0;
+
+	while (toSubmit > 0)
+	{
+		int ret = sys_io_uring_enter(m_ringFd, toSubmit, 0, 0);
+		if (ret < 0 && errno == EINTR) continue;
+		// EAGAIN/EBUSY: short of memory, or completions are backed up; the
+		// entries stay in the ring and go with the next submit
+		if (ret <= 0) break;
+		toSubmit -= (unsigned)ret;
+	}
+}
+
+void IoUringSender::detach(int slot)
+{
+	m_slots[slot].proc = NULL;
+
+	// whatever is queued goes in first, then is cancelled along with a
+	// write waiting for POLLOUT, before the caller closes the fd
+	uint64_t targets[2] = { (uint64_t)slot | kPollFlag, (uint64_t)slot };
+	for (int i = 0; i < 2; i++)
+	{
+		struct io_uring_sqe* sqe = getSqe();
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = targets[i];
+		sqe->user_data = CANCEL_USER_DATA;
+	}
+	submit();
+}
+
+void IoUringSender::completionHandler(void* clientData, int /*mask*/)
+{
+	((IoUringSender*) clientData)->reapCompletions();
+}
+
+void IoUringSender::reapCompletions()
+{
+	uint64_t n;
+	while (::read(m_eventFd, &n, sizeof(n)) > 0) {}
+
+	unsigned head = *m_cqHead;
+	for (;;)
+	{
+		unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+		if (head == tail) break;
+
+		struct io_uring_cqe* cqe = &m_cqes[head & m_cqMask];
+		uint64_t userData = cqe->user_data;
+		int res = cqe->res;
+		head++;
+		__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+
+		// a failed poll shows up again as a cancelled write
+		if (userData == CANCEL_USER_DATA || (userData & kPollFlag)) continue;
+
+		int slot = (int)userData;
+		Slot& s = m_slots[slot];
+		if (s.proc == NULL)
+		{
+			releaseBuffer(slot);
+			continue;
+		}
+
+		if (res == -EAGAIN)
+		{
+			queueRest(slot, true);
+			continue;
+		}
+		if (res > 0)
+		{
+			s.sent += (uint32_t)res;
+			if (s.sent < s.len)
+			{
+				queueRest(slot, true); // the socket buffer filled up
+				continue;
+			}
+		}
+
+		CompletionProc* proc = s.proc;
+		void* data = s.clientData;
+		int result = (res < 0) ? res : (int)s.len;
+		if (res == 0) result = -EPIPE;
+		releaseBuffer(slot);
+		proc(data, result);
+	}
+
+	submit();
+}
+
+#else // !__linux__
+
+IoUringSender* IoUringSender::createNew(TaskScheduler& /*scheduler*/, uint32_t /*numBuffers*/, uint32_t /*bufferSize*/)
+{
+	return NULL;
+}
+
+IoUringSender::~IoUringSender()
+{
+}
+
+int IoUringSender::acquireBuffer() { return -1; }
+void IoUringSender::queueWrite(int, int, uint32_t, CompletionProc*, void*) {}
+void IoUringSender::submit() {}
+void IoUringSender::detach(int) {}
+
+#endif
@@ -0,0 +1,108 @@
+/**
+ * @file IoUringSender.h
+ * @brief  基于 io_uring 的批量发送后端(仅 Linux)
+ *
+ *	每个事件循环一个. 待发送的数据先拷进预先注册给内核的缓冲池,
+ *	一轮 flush 中所有会话的写请求只用一次 io_uring_enter 提交;
+ *	socket 写满时用 POLLOUT 和剩余部分的写请求链接起来重新提交, 不回到用户态轮询.
+ *	完成通知通过注册的 eventfd 交给 TaskScheduler.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-17
+ */
+#ifndef IO_URING_SENDER_H
+#define IO_URING_SENDER_H
+
+#include <stdint.h>
+#include <vector>
+#include "UsageEnvironment.hh"
+
+class IoUringSender
+{
+	public:
+		// Called on the loop thread once the whole buffer went out (result:
+		// its length) or the write failed (result: -errno).
+		typedef void CompletionProc(void* clientData, int result);
+
+		enum
+		{
+			kDefaultNumBuffers	= 256,
+			kDefaultBufferSize	= 16 * 1024
+		};
+
+		// NULL where io_uring isn't available (other systems, old kernels,
+		// seccomp).
+		static IoUringSender* createNew(TaskScheduler& scheduler,
+				uint32_t numBuffers = kDefaultNumBuffers, uint32_t bufferSize = kDefaultBufferSize);
+		~IoUringSender();
+
+		// A free pool buffer, or -1 if all of them are in flight.
+		int acquireBuffer();
+		char* buffer(int slot) { return m_pool + (size_t)slot * m_bufferSize; }
+		uint32_t bufferSize() const { return m_bufferSize; }
+
+		// Queues a write of the first "len" bytes of the buffer to "fd". The
+		// buffer is released once "proc" has been called.
+		void queueWrite(int slot, int fd, uint32_t len, CompletionProc* proc, void* clientData);
+		// Hands everything queued to the kernel, in one system call.
+		void submit();
+
+		// The writer is going away: its completion is not reported and the
+		// rest of the buffer is not written. Cancels what hasn't started yet
+		// before returning, so the fd can be closed right after.
+		void detach(int slot);
+
+	private:
+		struct Slot
+		{
+			int fd;
+			uint32_t len;
+			uint32_t sent;
+			CompletionProc* proc;
+			void* clientData;
+		};
+		enum { kPollFlag = 0x80000000 };
+
+		IoUringSender(TaskScheduler& scheduler);
+		int init(uint32_t numBuffers, uint32_t bufferSize);
+
+		struct io_uring_sqe* getSqe();
+		// the rest of the slot's buffer, after POLLOUT when "waitWritable"
+		void queueRest(int slot, bool waitWritable);
+		void releaseBuffer(int slot);
+
+		static void completionHandler(void* clientData, int mask);
+		void reapCompletions();
+
+	private:
+		TaskScheduler& m_scheduler;
+		int m_ringFd;
+		int m_eventFd;
+		bool m_fixedBuffers;	// the pool is registered, writes use WRITE_FIXED
+
+		// the mmap'ed rings
+		void* m_sqRing;
+		size_t m_sqRingSize;
+		void* m_cqRing;
+		size_t m_cqRingSize;
+		struct io_uring_sqe* m_sqes;
+		size_t m_sqesSize;
+		unsigned* m_sqTail;
+		unsigned* m_sqHead;
+		unsigned m_sqMask;
+		unsigned* m_sqArray;
+		unsigned* m_cqHead;
+		unsigned* m_cqTail;
+		unsigned m_cqMask;
+		struct io_uring_cqe* m_cqes;
+		unsigned m_toSubmit;
+
+		char* m_pool;
+		uint32_t m_numBuffers;
+		uint32_t m_bufferSize;
+		std::vector<Slot> m_slots;
+		std::vector<int> m_freeSlots;
+};
+
+#endif
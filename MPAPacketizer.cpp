@@ -0,0 +1,132 @@
+/**
+ * @file MPAPacketizer.cpp
+ * @brief  MPEG 音频 RTP 打包实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-07
+ */
+#include "MPAPacketizer.h"
+#include <string.h>
+#include <new>
+
+MPAPacketizer::MPAPacketizer()
+	: m_maxPacket(0), m_maxAggregateUs(0), m_aggBuf(NULL)
+{
+	setLimits(kDefaultMTU, 0);
+}
+
+MPAPacketizer::~MPAPacketizer()
+{
+	delete[] m_aggBuf;
+}
+
+int MPAPacketizer::setLimits(uint32_t mtu, uint32_t maxAggregateUs)
+{
+	uint32_t maxPacket = maxPacketSize(mtu);
+	if (maxPacket != m_maxPacket || m_aggBuf == NULL)
+	{
+		char* buf = new (std::nothrow) char[maxPacket];
+		if (buf == NULL) return -1;
+		delete[] m_aggBuf;
+		m_aggBuf = buf;
+		m_maxPacket = maxPacket;
+		::memset(m_aggBuf, 0, kHeaderSize);	// whole frames: offset 0
+	}
+	m_maxAggregateUs = maxAggregateUs;
+	reset();
+	return 0;
+}
+
+void MPAPacketizer::reset()
+{
+	m_frame = NULL;
+	m_aggLen = 0;
+	m_aggSent = false;
+}
+
+bool MPAPacketizer::addFrame(const char* data, uint32_t len, uint32_t timestamp, int64_t frameUs,
+		int64_t durationUs, int64_t when)
+{
+	if (len > 0xFFFF) return false;
+
+	m_frame = (len > 0) ? data : NULL;
+	m_frameLen = len;
+	m_frameOffset = 0;
+	m_frameTimestamp = timestamp;
+	m_frameUs = frameUs;
+	m_frameDurationUs = durationUs;
+	m_frameWhen = when;
+	return true;
+}
+
+bool MPAPacketizer::nextPacket(Packet& pkt)
+{
+	if (m_aggSent)
+	{
+		m_aggLen = 0;
+		m_aggSent = false;
+	}
+	if (m_frame == NULL) return false;
+
+	bool aggregate = (m_maxAggregateUs > 0) && (m_frameOffset == 0) && (m_frameLen <= maxPayload());
+
+	// what is gathered goes out before anything of a later frame does
+	if ((m_aggLen > 0) && (!aggregate || (m_aggLen + m_frameLen > maxPayload())))
+		return emitAggregate(pkt);
+	if (!aggregate)
+		return emitFragment(pkt);
+
+	if (m_aggLen == 0)
+	{
+		m_aggTimestamp = m_frameTimestamp;
+		m_aggStartUs = m_frameUs;
+		m_aggWhen = m_frameWhen;
+	}
+	::memcpy(m_aggBuf + kHeaderSize + m_aggLen, m_frame, m_frameLen);
+	m_aggLen += m_frameLen;
+	m_frame = NULL;
+
+	// full, or long enough; a step back in time ends the run as well
+	int64_t span = m_frameUs + m_frameDurationUs - m_aggStartUs;
+	if ((m_aggLen == maxPayload()) || (span < 0) || (span >= m_maxAggregateUs))
+		return emitAggregate(pkt);
+	return false;
+}
+
+bool MPAPacketizer::emitAggregate(Packet& pkt)
+{
+	pkt.iov[0].iov_base = m_aggBuf;
+	pkt.iov[0].iov_len = kHeaderSize + m_aggLen;
+	pkt.iovcnt = 1;
+	pkt.len = kHeaderSize + m_aggLen;
+	pkt.timestamp = m_aggTimestamp;
+	pkt.when = m_aggWhen;
+	m_aggSent = true;
+	return true;
+}
+
+bool MPAPacketizer::emitFragment(Packet& pkt)
+{
+	uint32_t n = m_frameLen - m_frameOffset;
+	if (n > maxPayload()) n = maxPayload();
+
+	// MBZ, then the offset of this piece within the frame
+	m_fragHeader[0] = 0;
+	m_fragHeader[1] = 0;
+	m_fragHeader[2] = (char)(m_frameOffset >> 8);
+	m_fragHeader[3] = (char)m_frameOffset;
+
+	pkt.iov[0].iov_base = m_fragHeader;
+	pkt.iov[0].iov_len = kHeaderSize;
+	pkt.iov[1].iov_base = (void*)(m_frame + m_frameOffset);
+	pkt.iov[1].iov_len = n;
+	pkt.iovcnt = 2;
+	pkt.len = kHeaderSize + n;
+	pkt.timestamp = m_frameTimestamp;
+	pkt.when = m_frameWhen;
+
+	m_frameOffset += n;
+	if (m_frameOffset == m_frameLen)
+		m_frame = NULL;
+	return true;
+}
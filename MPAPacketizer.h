@@ -0,0 +1,66 @@
+/**
+ * @file MPAPacketizer.h
+ * @brief  MPEG 音频(MP3)的 RTP 打包, RFC 2250
+ *
+ *	每个 RTP 包的负载以 4 字节的 MPA 头开始(16 位保留 + 16 位分片偏移).
+ *	超过包长上限的帧拆成多个分片, 各分片时间戳相同, 分片偏移为该片在帧内的字节位置;
+ *	小帧可以合并: 若干完整的帧放进同一个包, 直到包满或累计时长达到合并上限.
+ *	分片直接引用调用者的帧数据, 不拷贝; 合并的帧拷进内部缓冲.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-07
+ */
+#ifndef MPA_PACKETIZER_H
+#define MPA_PACKETIZER_H
+
+#include "RTPPacketizer.h"
+
+class MPAPacketizer : public RTPPacketizer
+{
+	public:
+		enum { kHeaderSize = 4 };
+
+		MPAPacketizer();
+		virtual ~MPAPacketizer();
+
+		// "maxAggregateUs": the longest run of frames one packet may carry,
+		// 0: a packet never carries more than one frame.
+		virtual int setLimits(uint32_t mtu, uint32_t maxAggregateUs);
+
+		// Frames of more than 64K can't be fragmented (16 bit offsets).
+		virtual bool addFrame(const char* data, uint32_t len, uint32_t timestamp, int64_t frameUs,
+				int64_t durationUs, int64_t when);
+		virtual bool nextPacket(Packet& pkt);
+		virtual void dropFrame() { m_frame = NULL; }
+		virtual void reset();
+
+	private:
+		uint32_t maxPayload() const { return m_maxPacket - kRTPHeaderSize - kHeaderSize; }
+		bool emitAggregate(Packet& pkt);
+		bool emitFragment(Packet& pkt);
+
+	private:
+		uint32_t m_maxPacket;		// RTP header and payload
+		int64_t m_maxAggregateUs;
+
+		// the frame being handed out
+		const char* m_frame;
+		uint32_t m_frameLen;
+		uint32_t m_frameOffset;
+		uint32_t m_frameTimestamp;
+		int64_t m_frameUs;
+		int64_t m_frameDurationUs;
+		int64_t m_frameWhen;
+		char m_fragHeader[kHeaderSize];
+
+		// whole frames gathered for one packet, after a zero MPA header
+		char* m_aggBuf;
+		uint32_t m_aggLen;			// 0: nothing gathered
+		uint32_t m_aggTimestamp;
+		int64_t m_aggStartUs;
+		int64_t m_aggWhen;
+		bool m_aggSent;				// handed out, to be cleared on the next call
+};
+
+#endif
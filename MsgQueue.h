@@ -1,57 +1,73 @@
 #ifndef NS_PROXYER_MSG_QUEUE_H_
 #define NS_PROXYER_MSG_QUEUE_H_
 
-#include "ringbuffer.h"
+#include "RingQueue.h"
 
 template <class T>
 class MsgQueue
 {
 public:
-    MsgQueue() : queue_(NULL)
+    enum { kDefaultCapacity = 1024 };
+
+    MsgQueue()
     {
     }
-    
-    void init()
+
+    // capacity is rounded up to a power of two
+    int init(uint32_t capacity = kDefaultCapacity)
     {
-        queue_ = RingBufferInit();
+        return queue_.init(capacity);
     }
 
-    ~MsgQueue()
+    virtual ~MsgQueue()
     {
-        RingBufferDestroy(queue_);
     }
 
+    // blocks while the queue is full
     virtual int enqueue(T* item)
     {
-        return RingBufferMrMwPut(queue_, item);
+        queue_.push(item);
+        return 0;
+    }
+
+    virtual bool try_enqueue(T* item)
+    {
+        return queue_.tryPush(item);
     }
-    
+
     virtual T* dequeue_no_wait()
     {
-        return static_cast<T*>(RingBufferMrMwGetNoWait(queue_));
+        return queue_.tryPop();
+    }
+
+    // takes up to n items without blocking, returns how many
+    virtual uint32_t dequeue_n(T** items, uint32_t n)
+    {
+        return queue_.popN(items, n);
     }
 
 	virtual T* peek()
 	{
-        return static_cast<T*>(RingBufferPeek(queue_));
+        return queue_.peek();
 	}
-    
+
+    // blocks while the queue is empty
     virtual T* dequeue()
     {
-        return static_cast<T*>(RingBufferMrMwGet(queue_));
+        return queue_.pop();
     }
 
     virtual bool isEmpty()
     {
-        return RingBufferIsEmpty(queue_);
+        return queue_.empty();
     }
-    
+
     virtual bool isFull()
     {
-        return RingBufferIsFull(queue_);
+        return queue_.full();
     }
 private:
-    RingBuffer16* queue_;
+    RingQueue<T> queue_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,431 @@
+/**
+ * @file PacketQueue.cpp
+ * @brief  待发送包队列实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-06-20
+ */
+#include "common.h"
+#include "PacketQueue.h"
+#include "Socket.h"
+#include "UDPSocket.h"
+#include "SessionStats.h"
+#include <string.h>
+#include <assert.h>
+
+#define PACKET_QUEUE_MIN_BYTES		4096
+#define PACKET_QUEUE_MIN_PACKETS	64
+
+PacketQueue::PacketQueue(uint32_t maxPackets, uint32_t maxBytes)
+	: m_maxPackets(maxPackets), m_maxBytes(maxBytes),
+	m_buf(NULL), m_capacity(0), m_head(0), m_numBytes(0),
+	m_lens(NULL), m_times(NULL), m_lensCapacity(0), m_firstPacket(0), m_numPackets(0), m_headSent(0),
+	m_pinned(0), m_stats(NULL)
+{
+}
+
+PacketQueue::~PacketQueue()
+{
+	for (size_t i = 0; i < m_retired.size(); i++)
+		delete[] m_retired[i].buf;
+	delete[] m_buf;
+	delete[] m_lens;
+	delete[] m_times;
+}
+
+void PacketQueue::setLimits(uint32_t maxPackets, uint32_t maxBytes)
+{
+	// packets already queued stay queued; the limits apply to new ones
+	m_maxPackets = maxPackets;
+	m_maxBytes = maxBytes;
+}
+
+int PacketQueue::push(const struct iovec* iov, int iovcnt, int64_t when)
+{
+	uint32_t len = 0;
+	for (int i = 0; i < iovcnt; i++)
+		len += (uint32_t)iov[i].iov_len;
+	if (len == 0) return ET_NoErr;
+
+	if ((m_numPackets + 1 > m_maxPackets) || (m_numBytes + len > m_maxBytes))
+		return ET_NotEnoughSpace;
+	if (!reserve(len, 1))
+		return ET_NotEnoughSpace;
+
+	copyIn(iov, iovcnt, 0);
+
+	uint32_t idx = (m_firstPacket + m_numPackets) % m_lensCapacity;
+	m_lens[idx] = len;
+	m_times[idx] = when;
+	m_numPackets++;
+	m_numBytes += len;
+	publishDepth();
+	return ET_NoErr;
+}
+
+void PacketQueue::pushRemainder(const struct iovec* iov, int iovcnt, uint32_t sent, int64_t when)
+{
+	assert(empty());
+
+	uint32_t len = 0;
+	for (int i = 0; i < iovcnt; i++)
+		len += (uint32_t)iov[i].iov_len;
+	if (sent >= len) return;
+	if (!reserve(len - sent, 1))
+		return;
+
+	copyIn(iov, iovcnt, sent);
+
+	// as if the whole packet had been queued and "sent" bytes of it consumed
+	m_lens[m_firstPacket] = len;
+	m_times[m_firstPacket] = when;
+	m_numPackets = 1;
+	m_numBytes = len - sent;
+	m_headSent = sent;
+	publishDepth();
+}
+
+int PacketQueue::flush(Socket* sock)
+{
+	int64_t now = (m_stats != NULL) ? monotonicUs() : 0;
+	while (m_numBytes > 0)
+	{
+		struct iovec iov[2];
+		int iovcnt = 1;
+		uint32_t first = m_capacity - m_head;
+		if (first > m_numBytes) first = m_numBytes;
+
+		iov[0].iov_base = m_buf + m_head;
+		iov[0].iov_len = first;
+		if (first < m_numBytes)
+		{
+			iov[1].iov_base = m_buf;
+			iov[1].iov_len = m_numBytes - first;
+			iovcnt = 2;
+		}
+
+		uint32_t total = m_numBytes;
+		uint32_t sent = 0;
+		ET_Error theErr;
+		if (sock->IsZeroCopy() && (total >= kZeroCopyMinBytes))
+		{
+			uint32_t id = 0;
+			bool pinned = false;
+			theErr = sock->WriteVZeroCopy(iov, iovcnt, &sent, &id, &pinned);
+			if ((theErr == ET_NoErr) && pinned)
+			{
+				ZeroCopySend zc = { id, sent, false };
+				m_zcSends.push_back(zc);
+				m_pinned += sent;
+			}
+		}
+		else
+		{
+			theErr = sock->WriteV(iov, iovcnt, &sent);
+		}
+		if (theErr != ET_NoErr)
+			return theErr;
+
+		consume(sent, now);
+		if (sent < total)
+		{
+			if ((sent > 0) && (m_stats != NULL)) m_stats->onPartialWrite();
+			return EAGAIN; // the socket buffer is full
+		}
+	}
+
+	return ET_NoErr;
+}
+
+int PacketQueue::flushDatagrams(UDPSocket* sock)
+{
+	// datagrams leave whole, so no packet is ever partly sent here
+	assert(m_headSent == 0);
+
+	int64_t now = (m_stats != NULL) ? monotonicUs() : 0;
+	while (m_numPackets > 0)
+	{
+		struct iovec iov[2 * UDPSocket::kMaxDatagramsPerSend];
+		uint32_t iovcnts[UDPSocket::kMaxDatagramsPerSend];
+		uint32_t count = 0;
+		int iovcnt = 0;
+		uint32_t off = m_head;
+		for (; (count < m_numPackets) && (count < UDPSocket::kMaxDatagramsPerSend); count++)
+		{
+			uint32_t len = m_lens[(m_firstPacket + count) % m_lensCapacity];
+			uint32_t first = m_capacity - off;
+			if (first > len) first = len;
+
+			iov[iovcnt].iov_base = m_buf + off;
+			iov[iovcnt++].iov_len = first;
+			iovcnts[count] = 1;
+			if (first < len)
+			{
+				iov[iovcnt].iov_base = m_buf;
+				iov[iovcnt++].iov_len = len - first;
+				iovcnts[count] = 2;
+			}
+			off = (off + len) % m_capacity;
+		}
+
+		uint32_t sent = 0;
+		ET_Error theErr = sock->SendDatagrams(iov, iovcnts, count, &sent);
+		if (theErr != ET_NoErr)
+			return theErr;
+
+		uint32_t sentBytes = 0;
+		for (uint32_t i = 0; i < sent; i++)
+			sentBytes += m_lens[(m_firstPacket + i) % m_lensCapacity];
+		consume(sentBytes, now);
+		if (sent < count)
+		{
+			if ((sent > 0) && (m_stats != NULL)) m_stats->onPartialWrite();
+			return EAGAIN; // the socket buffer is full
+		}
+	}
+
+	return ET_NoErr;
+}
+
+void PacketQueue::releaseZeroCopy(uint32_t first, uint32_t last)
+{
+	if (m_zcSends.empty()) return;
+
+	// the sends are numbered one after the other, oldest at the front
+	uint32_t base = m_zcSends.front().id;
+	uint32_t end = base + (uint32_t)m_zcSends.size() - 1;
+	if ((int32_t)(first - base) < 0) first = base;
+	if ((int32_t)(last - end) > 0) last = end;
+	for (uint32_t id = first; (int32_t)(last - id) >= 0; id++)
+		m_zcSends[id - base].done = true;
+
+	while (!m_zcSends.empty() && m_zcSends.front().done)
+	{
+		m_pinned -= m_zcSends.front().bytes;
+		m_zcSends.pop_front();
+	}
+
+	while (!m_retired.empty() 
+			&& (m_zcSends.empty() || (int32_t)(m_zcSends.front().id - m_retired.front().lastId) > 0))
+	{
+		delete[] m_retired.front().buf;
+		m_retired.erase(m_retired.begin());
+	}
+}
+
+uint32_t PacketQueue::take(char* buf, uint32_t maxBytes)
+{
+	uint32_t n = (m_numBytes < maxBytes) ? m_numBytes : maxBytes;
+	uint32_t first = m_capacity - m_head;
+	if (first > n) first = n;
+
+	if (first > 0) ::memcpy(buf, m_buf + m_head, first);
+	if (n > first) ::memcpy(buf + first, m_buf, n - first);
+	// counted as sent once handed over
+	consume(n, (m_stats != NULL) ? monotonicUs() : 0);
+	return n;
+}
+
+void PacketQueue::discardPending()
+{
+	if (m_numPackets == 0) return;
+
+	if (m_headSent == 0)
+	{
+		// the zero copy sends are still out, unlike clear()
+		if (m_pinned == 0) m_head = 0;
+		m_numBytes = 0;
+		m_firstPacket = 0;
+		m_numPackets = 0;
+		publishDepth();
+		return;
+	}
+
+	// keep only the rest of the partly written packet
+	m_numBytes = m_lens[m_firstPacket] - m_headSent;
+	m_numPackets = 1;
+	publishDepth();
+}
+
+void PacketQueue::clear()
+{
+	for (size_t i = 0; i < m_retired.size(); i++)
+		delete[] m_retired[i].buf;
+	m_retired.clear();
+	m_zcSends.clear();
+	m_pinned = 0;
+
+	m_head = 0;
+	m_numBytes = 0;
+	m_firstPacket = 0;
+	m_numPackets = 0;
+	m_headSent = 0;
+	publishDepth();
+}
+
+uint32_t PacketQueue::dropOldest(uint32_t count)
+{
+	uint32_t keep = (m_headSent > 0) ? 1 : 0; // the packet on the wire stays
+	if (count > m_numPackets - keep) count = m_numPackets - keep;
+	if (count == 0) return 0;
+
+	uint32_t dropBytes = 0;
+	for (uint32_t i = 0; i < count; i++)
+		dropBytes += m_lens[(m_firstPacket + keep + i) % m_lensCapacity];
+
+	if (keep)
+	{
+		// move the rest of the started packet up against the packets that
+		// stay (backwards, the ranges may overlap)
+		uint32_t rest = m_lens[m_firstPacket] - m_headSent;
+		for (uint32_t i = rest; i > 0; i--)
+			m_buf[(m_head + dropBytes + i - 1) % m_capacity] = m_buf[(m_head + i - 1) % m_capacity];
+
+		uint32_t to = (m_firstPacket + count) % m_lensCapacity;
+		m_lens[to] = m_lens[m_firstPacket];
+		m_times[to] = m_times[m_firstPacket];
+	}
+
+	if (m_pinned > 0)
+	{
+		// the bytes skipped over lie right behind the pinned ones: free
+		// them with the last zero copy send
+		m_zcSends.back().bytes += dropBytes;
+		m_pinned += dropBytes;
+	}
+
+	m_head = (m_head + dropBytes) % m_capacity;
+	m_firstPacket = (m_firstPacket + count) % m_lensCapacity;
+	m_numPackets -= count;
+	m_numBytes -= dropBytes;
+	publishDepth();
+	return count;
+}
+
+uint32_t PacketQueue::dropOlderThan(int64_t when)
+{
+	uint32_t keep = (m_headSent > 0) ? 1 : 0;
+	uint32_t count = 0;
+	while ((keep + count < m_numPackets) 
+			&& (m_times[(m_firstPacket + keep + count) % m_lensCapacity] < when))
+		count++;
+
+	return dropOldest(count);
+}
+
+bool PacketQueue::reserve(uint32_t bytes, uint32_t packets)
+{
+	if (m_numBytes + m_pinned + bytes > m_capacity)
+	{
+		uint32_t newCapacity = (m_capacity == 0) ? PACKET_QUEUE_MIN_BYTES : m_capacity;
+		while (newCapacity < m_numBytes + bytes) newCapacity *= 2;
+
+		char* newBuf = new char[newCapacity];
+		if (newBuf == NULL) return false;
+
+		// unwrap the queued bytes to the start of the new buffer
+		uint32_t first = m_capacity - m_head;
+		if (first > m_numBytes) first = m_numBytes;
+		if (first > 0) ::memcpy(newBuf, m_buf + m_head, first);
+		if (m_numBytes > first) ::memcpy(newBuf + first, m_buf, m_numBytes - first);
+
+		if (m_pinned > 0)
+		{
+			// the kernel still reads from the old buffer
+			RetiredBuffer old = { m_buf, m_zcSends.back().id };
+			m_retired.push_back(old);
+			for (size_t i = 0; i < m_zcSends.size(); i++)
+				m_zcSends[i].bytes = 0;
+			m_pinned = 0;
+		}
+		else
+		{
+			delete[] m_buf;
+		}
+		m_buf = newBuf;
+		m_capacity = newCapacity;
+		m_head = 0;
+	}
+
+	if (m_numPackets + packets > m_lensCapacity)
+	{
+		uint32_t newCapacity = (m_lensCapacity == 0) ? PACKET_QUEUE_MIN_PACKETS : m_lensCapacity;
+		while (newCapacity < m_numPackets + packets) newCapacity *= 2;
+
+		uint32_t* newLens = new uint32_t[newCapacity];
+		int64_t* newTimes = new int64_t[newCapacity];
+		if (newLens == NULL || newTimes == NULL) 
+		{
+			delete[] newLens;
+			delete[] newTimes;
+			return false;
+		}
+
+		for (uint32_t i = 0; i < m_numPackets; i++)
+		{
+			newLens[i] = m_lens[(m_firstPacket + i) % m_lensCapacity];
+			newTimes[i] = m_times[(m_firstPacket + i) % m_lensCapacity];
+		}
+
+		delete[] m_lens;
+		delete[] m_times;
+		m_lens = newLens;
+		m_times = newTimes;
+		m_lensCapacity = newCapacity;
+		m_firstPacket = 0;
+	}
+
+	return true;
+}
+
+void PacketQueue::copyIn(const struct iovec* iov, int iovcnt, uint32_t skip)
+{
+	uint32_t tail = (m_head + m_numBytes) % m_capacity;
+	for (int i = 0; i < iovcnt; i++)
+	{
+		const char* src = (const char*) iov[i].iov_base;
+		uint32_t left = (uint32_t)iov[i].iov_len;
+		if (skip >= left)
+		{
+			skip -= left;
+			continue;
+		}
+		src += skip;
+		left -= skip;
+		skip = 0;
+
+		while (left > 0)
+		{
+			uint32_t n = m_capacity - tail;
+			if (n > left) n = left;
+			::memcpy(m_buf + tail, src, n);
+			src += n;
+			left -= n;
+			tail = (tail + n) % m_capacity;
+		}
+	}
+}
+
+void PacketQueue::consume(uint32_t bytes, int64_t now)
+{
+	if (m_stats != NULL && bytes > 0) m_stats->onBytesSent(bytes);
+
+	m_numBytes -= bytes;
+	m_head = ((m_numBytes == 0) && (m_pinned == 0)) ? 0 : (m_head + bytes) % m_capacity;
+
+	m_headSent += bytes;
+	while ((m_numPackets > 0) && (m_headSent >= m_lens[m_firstPacket]))
+	{
+		if (m_stats != NULL) m_stats->onPacketSent(now - m_times[m_firstPacket]);
+		m_headSent -= m_lens[m_firstPacket];
+		m_firstPacket = (m_firstPacket + 1) % m_lensCapacity;
+		m_numPackets--;
+	}
+	if (m_numPackets == 0) m_firstPacket = 0;
+	publishDepth();
+}
+
+void PacketQueue::publishDepth()
+{
+	if (m_stats != NULL) m_stats->setQueueDepth(m_numPackets, m_numBytes);
+}
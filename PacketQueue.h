@@ -0,0 +1,142 @@
+/**
+ * @file PacketQueue.h
+ * @brief  单个推送会话的待发送包队列
+ *
+ *	包(含 interleaved 头)按顺序首尾相接地存放在一块环形字节缓冲中,
+ *	flush 时用一次 writev 尽量多地写出, 写不完的部分留到 socket 可写时再写;
+ *	UDP 传输时每个包是一个数据报, 用 sendmmsg 一次发出多个.
+ *	socket 开启 MSG_ZEROCOPY 时, 大块的写直接从队列缓冲发出, 这部分字节要等内核
+ *	通知发送完成后才能复用.
+ *	队列的包数和字节数都有上限. 每个包记录入队时间, 可以按时间丢弃最老的包;
+ *	设置了统计对象时, 包写完时按入队时间记下延时, 并记录写出的字节数和队列深度.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-06-20
+ */
+#ifndef PACKET_QUEUE_H
+#define PACKET_QUEUE_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <deque>
+#include <vector>
+
+class Socket;
+class UDPSocket;
+class SessionStats;
+
+class PacketQueue
+{
+	public:
+		enum
+		{
+			kDefaultMaxPackets	= 512,
+			kDefaultMaxBytes	= 256 * 1024,
+			// smaller writes are copied even with MSG_ZEROCOPY on: pinning
+			// the pages costs more than the copy
+			kZeroCopyMinBytes	= 16 * 1024
+		};
+
+		PacketQueue(uint32_t maxPackets = kDefaultMaxPackets, uint32_t maxBytes = kDefaultMaxBytes);
+		~PacketQueue();
+
+		void setLimits(uint32_t maxPackets, uint32_t maxBytes);
+		// Where the queue reports what it sends (see SessionStats), NULL
+		// for nothing. The times passed to push() must then be monotonicUs().
+		void setStats(SessionStats* stats) { m_stats = stats; }
+
+		// Appends one packet, gathered from iov[0..iovcnt), queued at time
+		// "when" (any clock, see dropOlderThan()). Returns ET_NotEnoughSpace
+		// (and queues nothing) if it would exceed a limit.
+		int push(const struct iovec* iov, int iovcnt, int64_t when = 0);
+
+		// Queues the rest of a packet the caller has started writing itself:
+		// the first "sent" bytes of iov[0..iovcnt) are already out. Only for an
+		// empty queue. No limit applies, a started packet has to be finished.
+		void pushRemainder(const struct iovec* iov, int iovcnt, uint32_t sent, int64_t when = 0);
+
+		// Writes as much as the socket takes. Returns ET_NoErr once the
+		// queue is empty, EAGAIN if data is left, or the socket error.
+		// With MSG_ZEROCOPY on the socket, what is sent stays pinned in the
+		// buffer until releaseZeroCopy().
+		int flush(Socket* sock);
+		// The kernel is done with zero copy sends first..last (inclusive).
+		void releaseZeroCopy(uint32_t first, uint32_t last);
+		// The same for RTP over UDP: each packet goes out as one datagram,
+		// as many as the socket takes per sendmmsg.
+		int flushDatagrams(UDPSocket* sock);
+		// Moves up to "maxBytes" from the front into "buf" for the caller to
+		// write out itself, e.g. from an io_uring buffer. Returns the count.
+		uint32_t take(char* buf, uint32_t maxBytes);
+
+		// Drops every packet not yet started. A partly written packet is
+		// kept, so that whatever is sent next still lines up with the framing.
+		void discardPending();
+		// Also forgets the zero copy sends: the socket is being closed, and
+		// the next one numbers its sends from 0 again.
+		void clear();
+
+		// Drop-oldest: remove up to "count" packets / every packet queued
+		// before "when", from the front. A partly written packet is never
+		// dropped. Return the number of packets dropped.
+		uint32_t dropOldest(uint32_t count);
+		uint32_t dropOlderThan(int64_t when);
+
+		bool empty() const { return m_numPackets == 0; }
+		uint32_t packets() const { return m_numPackets; }
+		uint32_t bytes() const { return m_numBytes; }
+		// zero copy sends the kernel hasn't reported done yet
+		bool zeroCopyPending() const { return !m_zcSends.empty(); }
+
+	private:
+		bool reserve(uint32_t bytes, uint32_t packets);
+		// copies iov[0..iovcnt), less its first "skip" bytes, to the tail
+		void copyIn(const struct iovec* iov, int iovcnt, uint32_t skip);
+		// "now": when the write of these bytes was issued, for the stats
+		void consume(uint32_t bytes, int64_t now);
+		void publishDepth();
+
+	private:
+		uint32_t m_maxPackets;
+		uint32_t m_maxBytes;
+
+		// queued bytes, starting at m_head (wrapping at m_capacity)
+		char* m_buf;
+		uint32_t m_capacity;
+		uint32_t m_head;
+		uint32_t m_numBytes;
+
+		// length and queueing time of each queued packet; the first one may
+		// be partly sent
+		uint32_t* m_lens;
+		int64_t* m_times;
+		uint32_t m_lensCapacity;
+		uint32_t m_firstPacket;
+		uint32_t m_numPackets;
+		uint32_t m_headSent;
+
+		// MSG_ZEROCOPY: the m_pinned bytes just before m_head may still be
+		// read by the kernel. They are freed from the oldest send on, as
+		// the kernel reports the sends done.
+		struct ZeroCopySend
+		{
+			uint32_t id;
+			uint32_t bytes;
+			bool done;
+		};
+		std::deque<ZeroCopySend> m_zcSends;
+		uint32_t m_pinned;
+		// buffers reserve() outgrew while the kernel still read from them,
+		// each freed once send "lastId" is done
+		struct RetiredBuffer
+		{
+			char* buf;
+			uint32_t lastId;
+		};
+		std::vector<RetiredBuffer> m_retired;
+
+		SessionStats* m_stats;
+};
+
+#endif
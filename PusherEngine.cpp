@@ -0,0 +1,360 @@
+/**
+ * @file PusherEngine.cpp
+ * @brief  多路推流引擎实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-06-12
+ */
+#include "common.h"
+#include "PusherEngine.h"
+#include "PusherHandler.h"
+#include "IoUringSender.h"
+
+#define MAX_ENGINE_THREADS 64
+
+PusherLoop::PusherLoop()
+	: m_scheduler(NULL), m_env(NULL), m_cmdTrigger(0),
+	m_batching(false), m_flushWindowUs(0), m_flushTrigger(0), m_flushTimer(NULL),
+	m_useIoUring(false), m_ioUring(NULL), m_ioUringFailed(false),
+	m_tid(0), m_started(false), m_quit(0)
+{
+	m_cmdQueue.init(kCmdQueueSize);
+	pthread_mutex_init(&m_flushLock, NULL);
+#if defined(__linux__)
+	// no FD_SETSIZE limit, and every ready socket is handled per wakeup
+	m_scheduler = EpollTaskScheduler::createNew();
+	if (m_scheduler == NULL)
+#endif
+	m_scheduler = BasicTaskScheduler::createNew();
+	m_env = BasicUsageEnvironment::createNew(*m_scheduler);
+	m_cmdTrigger = m_scheduler->createEventTrigger(commandHandler);
+	m_flushTrigger = m_scheduler->createEventTrigger(flushTriggerHandler);
+}
+
+PusherLoop::~PusherLoop()
+{
+	stop();
+
+	// before the scheduler it is registered with
+	delete m_ioUring;
+	m_ioUring = NULL;
+
+	if (m_env != NULL)
+	{
+		m_env->reclaim();
+		m_env = NULL;
+	}
+
+	if (m_scheduler != NULL)
+	{
+		delete m_scheduler;
+		m_scheduler = NULL;
+	}
+
+	pthread_mutex_destroy(&m_flushLock);
+}
+
+int PusherLoop::start()
+{
+	if (m_started) return 0;
+
+	m_quit = 0;
+	if (pthread_create(&m_tid, NULL, threadProc, this) != 0)
+		return -1;
+
+	m_started = true;
+	return 0;
+}
+
+void PusherLoop::stop()
+{
+	if (!m_started) return;
+
+	m_quit = 1;
+	pthread_join(m_tid, NULL);
+	m_started = false;
+
+	// Commands posted after the loop exited still own their handlers.
+	handleCommands();
+}
+
+int PusherLoop::post(PusherHandler* hdr, int cmd)
+{
+	Command* c = new Command;
+	if (c == NULL) return ET_NotEnoughSpace;
+
+	c->handler = hdr;
+	c->cmd = cmd;
+	if (isLoopThread())
+	{
+		// waiting for ourselves to drain the queue would never end
+		if (!m_cmdOverflow.empty() || !m_cmdQueue.try_enqueue(c))
+			m_cmdOverflow.push_back(c);
+	}
+	else
+	{
+		m_cmdQueue.enqueue(c);
+	}
+	m_scheduler->triggerEvent(m_cmdTrigger, this);
+	return ET_NoErr;
+}
+
+void PusherLoop::setSendBatching(bool enable, uint32_t flushWindowUs)
+{
+	m_flushWindowUs = flushWindowUs;
+	m_batching = enable;
+}
+
+void PusherLoop::requestFlush(PusherHandler* hdr)
+{
+	pthread_mutex_lock(&m_flushLock);
+	bool first = m_flushList.empty();
+	m_flushList.push_back(hdr);
+	pthread_mutex_unlock(&m_flushLock);
+
+	// one wakeup per batch, however many handlers join it
+	if (first)
+		m_scheduler->triggerEvent(m_flushTrigger, this);
+}
+
+void PusherLoop::cancelFlush(PusherHandler* hdr)
+{
+	pthread_mutex_lock(&m_flushLock);
+	for (size_t i = 0; i < m_flushList.size(); i++)
+	{
+		if (m_flushList[i] == hdr)
+		{
+			m_flushList.erase(m_flushList.begin() + i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&m_flushLock);
+
+	// released from its own callback, in the middle of a flush
+	for (size_t i = 0; i < m_flushing.size(); i++)
+	{
+		if (m_flushing[i] == hdr) m_flushing[i] = NULL;
+	}
+}
+
+void PusherLoop::flushTriggerHandler(void* clientData)
+{
+	PusherLoop* loop = (PusherLoop*) clientData;
+	if (loop->m_flushWindowUs == 0)
+	{
+		loop->flushAll();
+	}
+	else if (loop->m_flushTimer == NULL)
+	{
+		loop->m_flushTimer = loop->m_scheduler->scheduleDelayedTask(loop->m_flushWindowUs, 
+				flushTimerHandler, loop);
+	}
+}
+
+void PusherLoop::flushTimerHandler(void* clientData)
+{
+	PusherLoop* loop = (PusherLoop*) clientData;
+	loop->m_flushTimer = NULL;
+	loop->flushAll();
+}
+
+void PusherLoop::flushAll()
+{
+	pthread_mutex_lock(&m_flushLock);
+	m_flushing.swap(m_flushList);
+	pthread_mutex_unlock(&m_flushLock);
+
+	if (m_useIoUring && m_ioUring == NULL && !m_ioUringFailed)
+	{
+		m_ioUring = IoUringSender::createNew(*m_scheduler);
+		m_ioUringFailed = (m_ioUring == NULL);
+	}
+
+	for (size_t i = 0; i < m_flushing.size(); i++)
+	{
+		if (m_flushing[i] != NULL)
+			m_flushing[i]->onFlush();
+	}
+
+	// the writes of the whole batch, in one system call
+	if (m_ioUring != NULL)
+		m_ioUring->submit();
+	m_flushing.clear();
+
+	// whoever joined meanwhile gets the next batch, even if its trigger went missing
+	if (flushPending())
+		m_scheduler->triggerEvent(m_flushTrigger, this);
+}
+
+bool PusherLoop::flushPending()
+{
+	pthread_mutex_lock(&m_flushLock);
+	bool pending = !m_flushList.empty();
+	pthread_mutex_unlock(&m_flushLock);
+	return pending;
+}
+
+void* PusherLoop::threadProc(void* arg)
+{
+	PusherLoop* loop = (PusherLoop*) arg;
+	signal(SIGPIPE, SIG_IGN);
+	loop->m_scheduler->doEventLoop(&loop->m_quit);
+	return NULL;
+}
+
+void PusherLoop::commandHandler(void* clientData)
+{
+	PusherLoop* loop = (PusherLoop*) clientData;
+	loop->handleCommands();
+
+	// the flush trigger is only fired by the handler that finds the list empty, so
+	// a batch doesn't hang on that one wakeup: any command starts it too
+	if (loop->m_flushTimer == NULL && loop->flushPending())
+		flushTriggerHandler(loop);
+}
+
+void PusherLoop::handleCommands()
+{
+	Command* batch[kCmdBatch];
+	uint32_t n;
+	while ((n = m_cmdQueue.dequeue_n(batch, kCmdBatch)) > 0)
+	{
+		for (uint32_t i = 0; i < n; i++)
+			runCommand(batch[i]);
+	}
+
+	while (!m_cmdOverflow.empty())
+	{
+		Command* c = m_cmdOverflow.front();
+		m_cmdOverflow.pop_front();
+		runCommand(c);
+	}
+}
+
+void PusherLoop::runCommand(Command* c)
+{
+	PusherHandler* hdr = c->handler;
+	switch (c->cmd)
+	{
+		case kCmdStart:
+			hdr->onStart();
+			break;
+		case kCmdClose:
+			hdr->onClose();
+			break;
+		case kCmdDisconnect:
+			hdr->onDisconnect();
+			break;
+		case kCmdRelease:
+			hdr->onRelease();
+			break;
+		case kCmdWantWrite:
+			hdr->onWantWrite();
+			break;
+	}
+	delete c;
+}
+
+
+PusherEngine* PusherEngine::s_sharedEngine = NULL;
+pthread_once_t PusherEngine::s_sharedOnce = PTHREAD_ONCE_INIT;
+
+PusherEngine* PusherEngine::sharedEngine()
+{
+	pthread_once(&s_sharedOnce, createSharedEngine);
+	return s_sharedEngine;
+}
+
+void PusherEngine::createSharedEngine()
+{
+	s_sharedEngine = createNew(1);
+}
+
+PusherEngine* PusherEngine::createNew(int nThreads)
+{
+	PusherEngine* engine = new PusherEngine();
+	if (engine->init(nThreads) != 0)
+	{
+		engine->release();
+		return NULL;
+	}
+	return engine;
+}
+
+PusherEngine::PusherEngine()
+	: m_loops(NULL), m_numLoops(0), m_nextLoop(0),
+	m_maxConnecting(kDefaultMaxConnecting), m_numConnecting(0)
+{
+}
+
+PusherEngine::~PusherEngine()
+{
+}
+
+int PusherEngine::init(int nThreads)
+{
+	if (nThreads <= 0) nThreads = 1;
+	if (nThreads > MAX_ENGINE_THREADS) nThreads = MAX_ENGINE_THREADS;
+
+	m_loops = new PusherLoop*[nThreads];
+	for (int i = 0; i < nThreads; i++)
+	{
+		m_loops[i] = new PusherLoop();
+		m_numLoops++;
+		if (m_loops[i]->start() != 0)
+			return -1;
+	}
+	return 0;
+}
+
+PusherLoop* PusherEngine::assignLoop()
+{
+	if (m_numLoops == 0) return NULL;
+	return m_loops[__sync_fetch_and_add(&m_nextLoop, 1) % m_numLoops];
+}
+
+void PusherEngine::setMaxConnecting(int maxConnecting)
+{
+	m_maxConnecting = (maxConnecting > 0) ? maxConnecting : 1;
+}
+
+bool PusherEngine::acquireConnectSlot()
+{
+	for (;;)
+	{
+		int n = m_numConnecting;
+		if (n >= m_maxConnecting) return false;
+		if (__sync_bool_compare_and_swap(&m_numConnecting, n, n + 1)) return true;
+	}
+}
+
+void PusherEngine::releaseConnectSlot()
+{
+	__sync_fetch_and_sub(&m_numConnecting, 1);
+}
+
+void PusherEngine::setSendBatching(bool enable, uint32_t flushWindowUs)
+{
+	for (int i = 0; i < m_numLoops; i++)
+		m_loops[i]->setSendBatching(enable, flushWindowUs);
+}
+
+void PusherEngine::setIoUring(bool enable)
+{
+	for (int i = 0; i < m_numLoops; i++)
+		m_loops[i]->setIoUring(enable);
+}
+
+int PusherEngine::release()
+{
+	for (int i = 0; i < m_numLoops; i++)
+	{
+		delete m_loops[i];
+	}
+	delete[] m_loops;
+	m_loops = NULL;
+	m_numLoops = 0;
+
+	delete this;
+	return 0;
+}
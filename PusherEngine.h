@@ -0,0 +1,168 @@
+/**
+ * @file PusherEngine.h
+ * @brief  多路推流引擎: 在一个进程内用少量事件循环线程驱动大量 PusherHandler
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-06-12
+ */
+#ifndef PUSHER_ENGINE_H
+#define PUSHER_ENGINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+#include "BasicUsageEnvironment.hh"
+#include "EpollTaskScheduler.hh"
+#include "MsgQueue.h"
+
+class PusherHandler;
+class IoUringSender;
+
+/*
+ * One event loop thread. It owns a TaskScheduler and the sockets of every
+ * PusherHandler bound to it; all socket events, handshakes and teardowns of
+ * those handlers run on this thread.
+ */
+class PusherLoop
+{
+	public:
+		enum
+		{
+			kCmdStart		= 0,
+			kCmdClose		= 1,
+			kCmdDisconnect	= 2,
+			kCmdRelease		= 3,
+			kCmdWantWrite	= 4
+		};
+
+		PusherLoop();
+		~PusherLoop();
+
+		int start();
+		void stop();
+
+		// Thread safe: may be called from any thread. The command is run
+		// on the loop thread, in the order it was posted. Other threads wait
+		// while the command queue is full; the loop thread itself never does.
+		int post(PusherHandler* hdr, int cmd);
+
+		bool isLoopThread() const { return pthread_equal(pthread_self(), m_tid) != 0; }
+
+		TaskScheduler& scheduler() { return *m_scheduler; }
+		UsageEnvironment& env() { return *m_env; }
+
+		// Send batching: handlers leave their packets queued and the loop
+		// writes each handler's queue out with one writev, "flushWindowUs"
+		// after the first packet (0: at the end of the current iteration).
+		void setSendBatching(bool enable, uint32_t flushWindowUs);
+		bool sendBatching() const { return m_batching || m_useIoUring; }
+
+		// io_uring backend: every flush hands all of its handlers' writes to
+		// the kernel in one io_uring_enter. Implies send batching. Falls back
+		// to writev where io_uring isn't available.
+		void setIoUring(bool enable) { m_useIoUring = enable; }
+		// On the loop thread: the backend, if it is on and available.
+		IoUringSender* ioUring() { return m_useIoUring ? m_ioUring : NULL; }
+		// Even once turned off again, for the writes still in flight.
+		IoUringSender* ioUringSender() { return m_ioUring; }
+
+		// Thread safe. Puts the handler on the list written out at the next flush.
+		void requestFlush(PusherHandler* hdr);
+		// On the loop thread: takes the handler off that list.
+		void cancelFlush(PusherHandler* hdr);
+
+	private:
+		enum { kCmdQueueSize = 16384, kCmdBatch = 32 };
+
+		struct Command
+		{
+			PusherHandler* handler;
+			int cmd;
+		};
+
+		static void* threadProc(void* arg);
+		static void commandHandler(void* clientData);
+		void handleCommands();
+		void runCommand(Command* c);
+
+		static void flushTriggerHandler(void* clientData);
+		static void flushTimerHandler(void* clientData);
+		void flushAll();
+		bool flushPending();
+
+	private:
+		TaskScheduler* m_scheduler;
+		UsageEnvironment* m_env;
+		EventTriggerId m_cmdTrigger;
+		MsgQueue<Command> m_cmdQueue;
+		std::deque<Command*> m_cmdOverflow;	// loop thread only, used once the queue is full
+
+		bool volatile m_batching;
+		uint32_t volatile m_flushWindowUs;
+		EventTriggerId m_flushTrigger;
+		TaskToken m_flushTimer;
+		pthread_mutex_t m_flushLock;
+		std::vector<PusherHandler*> m_flushList;
+		std::vector<PusherHandler*> m_flushing; // the loop's copy while flushing
+
+		bool volatile m_useIoUring;
+		IoUringSender* m_ioUring;	// created on the loop thread by the first flush
+		bool m_ioUringFailed;
+
+		pthread_t m_tid;
+		bool m_started;
+		char volatile m_quit;
+};
+
+class PusherEngine
+{
+	public:
+		static PusherEngine* createNew(int nThreads);
+
+		// The library's own single-threaded engine, created on first use and
+		// kept for the life of the process. Used by handlers that were not
+		// given an engine but are started asynchronously.
+		static PusherEngine* sharedEngine();
+
+		// Picks the loop a new handler is bound to (round robin).
+		PusherLoop* assignLoop();
+
+		// Caps the handshakes in flight across all loops of the engine, so
+		// that thousands of streams (re)connecting at once don't flood the
+		// server. A handler that gets no slot tries again a little later.
+		void setMaxConnecting(int maxConnecting);
+		bool acquireConnectSlot();
+		void releaseConnectSlot();
+
+		// See PusherLoop::setSendBatching(); applies to every loop.
+		void setSendBatching(bool enable, uint32_t flushWindowUs);
+		// See PusherLoop::setIoUring(); applies to every loop.
+		void setIoUring(bool enable);
+
+		int release();
+
+		enum { kDefaultMaxConnecting = 64 };
+
+	protected:
+		PusherEngine();
+		~PusherEngine();
+
+		int init(int nThreads);
+
+		static void createSharedEngine();
+
+	private:
+		PusherLoop** m_loops;
+		int m_numLoops;
+		uint32_t m_nextLoop;
+		int volatile m_maxConnecting;
+		int volatile m_numConnecting;
+
+		static PusherEngine* s_sharedEngine;
+		static pthread_once_t s_sharedOnce;
+};
+
+#endif
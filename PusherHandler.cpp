@@ -8,345 +8,1821 @@
 #include "common.h"
 #include "PusherHandler.h"
 #include <errno.h>
+#include <stdlib.h>
+#include <strings.h>
 #include <arpa/inet.h>
 #include <sys/select.h>
+#include <time.h>
 #include "RTPPacket.h"
+#include "PusherEngine.h"
+#include "UDPSocket.h"
+#include "IoUringSender.h"
+#include "G711Encoder.h"
+#include "ImaAdpcmEncoder.h"
 
-#define MAX_RTP_PAYLOAD 1400
 #define RTP_HDR_SZ 12
 
+// how long each handshake request may take on an engine
+#define RTSP_REQUEST_TIMEOUT_MS 5000
 
-PusherHandler* PusherHandler::createNew()
+// reconnect backoff: doubles from the min up to the max, with jitter
+#define RECONNECT_MIN_DELAY_MS 500
+#define RECONNECT_MAX_DELAY_MS 30000
+// how soon a handler that got no connect slot tries again (plus jitter)
+#define CONNECT_SLOT_RETRY_MS 50
+
+// tries at binding an even RTP port with a free RTCP port above it
+#define UDP_PORT_PAIR_TRIES 16
+
+// unparsed input from the server dropped beyond this
+#define RX_BUF_MAX (64 * 1024 + 4)
+
+
+// the RTP clock a codec runs at whatever the source's rate (RFC 3551), 0: the source's
+static uint32_t codecClockRate(unsigned int codec)
+{
+	switch (codec)
+	{
+		case AUDIO_CODEC_G711:
+		case AUDIO_CODEC_G711A:
+		case AUDIO_CODEC_IMAADPCM_8K:
+			return 8000;
+		case AUDIO_CODEC_IMAADPCM_16K:
+			return 16000;
+		default:
+			return 0;
+	}
+}
+
+PusherHandler* PusherHandler::createNew(PusherEngine* engine)
+{
+	PusherHandler* hdr = new PusherHandler();
+	if (hdr != NULL && engine != NULL)
+	{
+		hdr->m_engine = engine;
+		hdr->m_loop = engine->assignLoop();
+	}
+	return hdr;
+}
+
+int PusherHandler::setCallbackFunc(PusherCallback cb, void* cbParam)
+{
+	m_callbackFunc = cb;
+	m_cbParam = cbParam;
+	return 0;
+}
+
+int PusherHandler::startStream(const char* url, 
+	                                RTP_ConnectType connType, 
+	                                const char* username,
+		                            const char* password, 
+		                            int reconn, 
+		                            const MediaInfo& mi)
+{
+	if (!m_url.empty()) return 0; // is running
+
+	int ret = prepareStream(url, connType, username, password, reconn, mi);
+	if (ret != 0) return ret;
+
+	if (m_loop != NULL)
+	{
+		// the handshake runs on the engine thread, the result is reported
+		// through the callback.
+		return m_loop->post(this, PusherLoop::kCmdStart);
+	}
+	return SetupStream();
+}
+
+int PusherHandler::startStreamAsync(const char* url, 
+	                                RTP_ConnectType connType, 
+	                                const char* username,
+		                            const char* password, 
+		                            int reconn, 
+		                            const MediaInfo& mi)
+{
+	if (m_url.empty())
+	{
+		int ret = bindSharedEngine();
+		if (ret != 0) return ret;
+	}
+
+	return startStream(url, connType, username, password, reconn, mi);
+}
+
+int PusherHandler::bindSharedEngine()
+{
+	// a handler created without an engine shares the library's own one
+	if (m_loop != NULL) return 0;
+
+	PusherEngine* engine = PusherEngine::sharedEngine();
+	if (engine == NULL) return ET_NotEnoughSpace;
+	m_engine = engine;
+	m_loop = engine->assignLoop();
+	return 0;
+}
+
+int PusherHandler::prepareStream(const char* url, 
+	                                RTP_ConnectType connType, 
+	                                const char* username,
+		                            const char* password, 
+		                            int reconn, 
+		                            const MediaInfo& mi)
+{
+	int ret = 0;
+
+	char addr[32] = {0};
+	int port = 0;
+
+	char *tuser = NULL, *tpasswd = NULL;	
+	ret = parseDetailRTSPURL(url, tuser, tpasswd, &addr[0], &port);
+	if (ret < 0) return ret;
+
+	m_url = url;
+	if (tuser != NULL)
+	{
+		m_username = tuser;
+		delete[] tuser;
+	}
+	if (tpasswd != NULL)
+	{
+		m_password = tpasswd;
+		delete[] tpasswd;
+	}
+	if (username != NULL) m_username = username;
+	if (password != NULL) m_password = password;
+
+	m_serverAddr = (uint32_t)ntohl(::inet_addr(addr));
+	m_serverPort = (uint16_t)port;
+	m_reconn = reconn;
+	m_retries = 0;
+	createConnection();
+
+    //����SDP
+	m_connType = connType;
+	memcpy(&m_mediaInfo, &mi, sizeof(mi));
+
+	// the sampled codecs run on their own clock; the rate given is that of
+	// the PCM for pushPCM(), resampled where it differs
+	uint32_t clockRate = codecClockRate(mi.audioCodec);
+	Resampler* resampler = NULL;
+	if (clockRate > 0)
+	{
+		if (mi.audioSamplerate > 0 && mi.audioSamplerate != clockRate)
+			resampler = Resampler::createNew(mi.audioSamplerate, clockRate, mi.audioChannel);
+		m_mediaInfo.audioSamplerate = clockRate;
+	}
+	pthread_mutex_lock(&m_pcmLock);
+	m_pcmRate = mi.audioSamplerate;
+	delete m_resampler;
+	m_resampler = resampler;
+	pthread_mutex_unlock(&m_pcmLock);
+
+	RTPPacketizer* packetizer = RTPPacketizer::createNew(m_mediaInfo);
+	if (packetizer == NULL || packetizer->setLimits(m_mtu, m_ptimeMs * 1000) != 0)
+	{
+		delete packetizer;
+		return ET_NotEnoughSpace;
+	}
+	pthread_mutex_lock(&m_sendLock);
+	delete m_packetizer;
+	m_packetizer = packetizer;
+	pthread_mutex_unlock(&m_sendLock);
+
+	ret = generateSDPString(addr, m_mediaInfo);
+
+    m_state = kSendingOptions;
+	return ret;
+}
+
+void PusherHandler::createConnection()
+{
+	m_socket = new TCPClientSocket(Socket::kNonBlockingSocketType);
+	m_socket->Set(m_serverAddr, m_serverPort);
+	m_rtspClient = new MyDarwin::RTSPClient(m_socket);
+	m_rtspClient->Set((char*)m_url.c_str());
+
+	if (!m_username.empty())
+		m_rtspClient->SetName((char*)m_username.c_str());
+	if (!m_password.empty())
+		m_rtspClient->SetPassword((char*)m_password.c_str());
+}
+
+void PusherHandler::closeConnection()
+{
+	setSocketHandling(false);
+	detachWrite();
+	cancelReport();
+	m_rxBuf.clear();
+
+	// pushFrame() checks m_state under the same lock before touching the socket
+	pthread_mutex_lock(&m_sendLock);
+	if (m_state == kPushing) m_state = kDone;
+	m_sendQueue.clear();
+	m_writePending = false;
+	m_sendError = 0;
+
+	delete m_rtspClient; m_rtspClient = NULL;
+	delete m_socket; m_socket = NULL;
+	closeUDPPorts();
+	pthread_mutex_unlock(&m_sendLock);
+}
+
+ET_Error PusherHandler::openUDPPorts()
+{
+	ET_Error theErr = ET_NoErr;
+	for (int i = 0; i < UDP_PORT_PAIR_TRIES; i++)
+	{
+		m_rtpSocket = new UDPSocket(Socket::kNonBlockingSocketType);
+		m_rtcpSocket = new UDPSocket(Socket::kNonBlockingSocketType);
+
+		// let the kernel pick the RTP port; RTCP has to get the odd one above it
+		theErr = m_rtpSocket->Open();
+		if (theErr == ET_NoErr) theErr = m_rtpSocket->Bind(INADDR_ANY, 0);
+		if (theErr == ET_NoErr)
+		{
+			uint16_t rtpPort = m_rtpSocket->GetLocalPort();
+			if ((rtpPort & 1) != 0 || rtpPort == 0xFFFE)
+			{
+				closeUDPPorts();
+				continue;
+			}
+
+			theErr = m_rtcpSocket->Open();
+			if (theErr == ET_NoErr) theErr = m_rtcpSocket->Bind(INADDR_ANY, rtpPort + 1);
+			if (theErr == ET_NoErr) 
+			{
+				// room for a burst of datagrams between two flushes
+				m_rtpSocket->SetSocketBufSize(256 * 1024);
+				m_rtpSocket->SetSegmentation(m_udpSegmentation);
+				return ET_NoErr;
+			}
+		}
+
+		closeUDPPorts();
+		if (theErr != EADDRINUSE) break;
+	}
+
+	if (theErr == ET_NoErr) theErr = EADDRINUSE;
+	return theErr;
+}
+
+void PusherHandler::closeUDPPorts()
+{
+	if (m_loop != NULL && m_rtpSocket != NULL)
+	{
+		m_loop->scheduler().disableBackgroundHandling(m_rtpSocket->GetSocketFD());
+		m_loop->scheduler().disableBackgroundHandling(m_rtcpSocket->GetSocketFD());
+	}
+
+	delete m_rtpSocket; m_rtpSocket = NULL;
+	delete m_rtcpSocket; m_rtcpSocket = NULL;
+}
+
+ET_Error PusherHandler::writePacket(const struct iovec* iov, int iovcnt, uint32_t* sent)
+{
+	if (m_rtpSocket == NULL)
+		return m_socket->GetSocket()->WriteV(iov, iovcnt, sent);
+
+	// a datagram goes out whole or not at all
+	*sent = 0;
+	ET_Error theErr = m_rtpSocket->SendV(iov, iovcnt);
+	if (theErr == ET_NoErr)
+	{
+		for (int i = 0; i < iovcnt; i++)
+			*sent += (uint32_t)iov[i].iov_len;
+	}
+	return theErr;
+}
+
+ET_Error PusherHandler::flushQueue()
+{
+	if (m_rtpSocket != NULL)
+		return m_sendQueue.flushDatagrams(m_rtpSocket);
+	return m_sendQueue.flush(m_socket->GetSocket());
+}
+
+int PusherHandler::closeStream()
+{
+	if (m_loop != NULL)
+		return m_loop->post(this, PusherLoop::kCmdClose);
+	return teardown();
+}
+
+int PusherHandler::teardown()
+{
+    int theErr = ET_NoErr;
+
+    if (m_state != kSendingTeardown)
+    {
+	    m_state = kSendingTeardown;
+		if (m_rtspClient != NULL && m_socket != NULL)
+		{
+			// finish a partly written packet so TEARDOWN starts on a frame boundary
+			pthread_mutex_lock(&m_sendLock);
+			m_sendQueue.discardPending();
+			flushQueue();
+			m_sendQueue.clear();
+			m_writePending = false;
+			pthread_mutex_unlock(&m_sendLock);
+
+            theErr = m_rtspClient->SendTeardown();
+            if (theErr == ET_NoErr)
+            {
+                m_state = kDone;
+                m_pusherState = PUSHER_STATE_DISCONNECTED;
+			    notify(m_pusherState, 0);
+
+			return 0;
+            }
+		}
+    }
+
+	return -1;
+}
+
+int PusherHandler::release() 
+{
+	CallbackNotifier* notifier = m_notifier;
+	int ret = 0;
+	if (m_loop != NULL && !m_loop->isLoopThread())
+	{
+		// the commands queued ahead (a close, say) still call back: wait
+		// for the loop to get through them and destroy us
+		ReleaseWait wait;
+		pthread_mutex_init(&wait.lock, NULL);
+		pthread_cond_init(&wait.cond, NULL);
+		wait.done = false;
+		m_releaseWait = &wait;
+
+		ret = m_loop->post(this, PusherLoop::kCmdRelease);
+		if (ret == ET_NoErr)
+		{
+			pthread_mutex_lock(&wait.lock);
+			while (!wait.done)
+				pthread_cond_wait(&wait.cond, &wait.lock);
+			pthread_mutex_unlock(&wait.lock);
+		}
+		else
+		{
+			m_releaseWait = NULL;
+		}
+
+		pthread_cond_destroy(&wait.cond);
+		pthread_mutex_destroy(&wait.lock);
+	}
+	else if (m_loop != NULL)
+	{
+		// from a callback on the loop: runs once it has returned
+		ret = m_loop->post(this, PusherLoop::kCmdRelease);
+	}
+	else
+	{
+		destroy();
+	}
+
+	// what is queued on the notifier is delivered before we return
+	if (notifier != NULL)
+		notifier->sync();
+	return ret;
+}
+
+void PusherHandler::destroy()
+{
+	cancelRequestTimer();
+	if (m_loop != NULL)
+	{
+		m_loop->scheduler().unscheduleDelayedTask(m_reconnectTimer);
+		m_loop->cancelFlush(this);
+	}
+	releaseConnectSlot();
+	setSocketHandling(false);
+	detachWrite();
+	cancelReport();
+
+	if (m_rtspClient != NULL)
+	{
+		delete m_rtspClient;
+		m_rtspClient = NULL;
+	}
+
+	if (m_socket != NULL)
+	{
+		delete m_socket;
+		m_socket = NULL;
+	}
+	closeUDPPorts();
+
+	if (m_sdp != NULL)
+	{
+		delete[] m_sdp;
+		m_sdp = NULL;
+	}
+
+	if (m_frameRing != NULL)
+	{
+		if (m_loop != NULL)
+			m_loop->scheduler().disableBackgroundHandling(m_frameRing->signalFd());
+		delete m_frameRing;
+		m_frameRing = NULL;
+	}
+
+	m_rtpSeq = 0;
+    delete this; 
+}
+
+int PusherHandler::pushFrame(MediaFrame* frame)
+{
+	if (m_frameRing != NULL)
+	{
+		if (frame == NULL) return ET_NotInPushingState;
+		if (m_state != kPushing)
+		{
+			m_stats.onDroppedNotPushing();
+			return ET_NotInPushingState;
+		}
+		if (!m_frameRing->put(frame, monotonicUs()))
+		{
+			m_stats.onDroppedRingFull();
+			return ET_NotEnoughSpace;
+		}
+		m_frameRing->notify();
+		return ET_NoErr;
+	}
+
+	return sendFrame(frame);
+}
+
+int PusherHandler::pushPCM(MediaFrame* frame)
+{
+	if (frame == NULL || m_url.empty()) return ET_NotInPushingState;
+
+	G711Encoder::Law law = G711Encoder::kULaw;
+	if (m_mediaInfo.audioCodec == AUDIO_CODEC_G711A)
+		law = G711Encoder::kALaw;
+	else if (m_mediaInfo.audioCodec != AUDIO_CODEC_G711 && !encodesADPCM())
+		return ET_NotSupported;
+
+	MediaFrame resampled;
+	pthread_mutex_lock(&m_pcmLock);
+	int ret = resamplePCM(&frame, &resampled);
+	if (ret == ET_NoErr && encodesADPCM())
+	{
+		const int16_t* pcm = NULL;
+		uint8_t* out = NULL;
+		uint32_t samples = 0;
+		ret = beginADPCM(frame, &pcm, &out, &samples);
+		if (ret == ET_NoErr)
+		{
+			ImaAdpcmEncoder::encode(m_adpcmState, pcm, out, samples);
+			ret = pushEncoded(frame);
+		}
+	}
+	else if (ret == ET_NoErr)
+	{
+		uint32_t samples = frame->frameLen / sizeof(int16_t);
+		ret = reservePCMBuffer(samples);
+		if (ret == ET_NoErr)
+		{
+			G711Encoder::encode(law, (const int16_t*)frame->frameData, m_pcmBuf, samples);
+			m_pcmLen = samples;
+			m_pcmLeading = false;
+			ret = pushEncoded(frame);
+		}
+	}
+	pthread_mutex_unlock(&m_pcmLock);
+	return ret;
+}
+
+int PusherHandler::pushPCMBatch(PusherHandler* const* handlers, MediaFrame* const* frames, int count, int* results)
+{
+	enum { kBatch = 64 };
+	int failed = 0;
+
+	for (int base = 0; base < count; base += kBatch)
+	{
+		int n = (count - base < kBatch) ? (count - base) : (int) kBatch;
+		int frameOf[kBatch];
+		ImaAdpcmEncoder::State* states[kBatch];
+		const int16_t* pcm[kBatch];
+		uint8_t* out[kBatch];
+		uint32_t samples[kBatch];
+		uint32_t common = 0;
+		int streams = 0;
+		MediaFrame resampled;
+
+		// DVI4 streams are set up and held; anything else is pushed as is
+		for (int i = base; i < base + n; i++)
+		{
+			PusherHandler* hdr = handlers[i];
+			int ret = ET_NoErr;
+			if (hdr == NULL)
+			{
+				ret = ET_NotInPushingState;
+			}
+			else if (frames[i] == NULL || hdr->m_url.empty() || !hdr->encodesADPCM())
+			{
+				ret = hdr->pushPCM(frames[i]);
+			}
+			else
+			{
+				MediaFrame* frame = frames[i];
+				pthread_mutex_lock(&hdr->m_pcmLock);
+				ret = hdr->resamplePCM(&frame, &resampled);
+				if (ret == ET_NoErr)
+					ret = hdr->beginADPCM(frame, &pcm[streams], &out[streams], &samples[streams]);
+				if (ret == ET_NoErr)
+				{
+					if (streams == 0 || samples[streams] < common) common = samples[streams];
+					states[streams] = &hdr->m_adpcmState;
+					frameOf[streams++] = i;
+					continue;
+				}
+				pthread_mutex_unlock(&hdr->m_pcmLock);
+			}
+			if (results != NULL) results[i] = ret;
+			if (ret != ET_NoErr) failed++;
+		}
+
+		// the length they all have side by side, the rest a stream at a time
+		ImaAdpcmEncoder::encodeStreams(states, pcm, out, streams, common);
+		for (int k = 0; k < streams; k++)
+		{
+			int i = frameOf[k];
+			PusherHandler* hdr = handlers[i];
+			ImaAdpcmEncoder::encode(*states[k], pcm[k] + common, out[k] + common / 2, samples[k] - common);
+			int ret = hdr->pushEncoded(frames[i]);
+			pthread_mutex_unlock(&hdr->m_pcmLock);
+
+			if (results != NULL) results[i] = ret;
+			if (ret != ET_NoErr) failed++;
+		}
+	}
+	return failed;
+}
+
+bool PusherHandler::encodesADPCM() const
+{
+	return (m_mediaInfo.audioCodec == AUDIO_CODEC_IMAADPCM_8K || m_mediaInfo.audioCodec == AUDIO_CODEC_IMAADPCM_16K)
+		&& (m_mediaInfo.audioChannel <= 1);
+}
+
+int PusherHandler::reservePCMBuffer(uint32_t bytes)
+{
+	if (bytes <= m_pcmBufSize) return ET_NoErr;
+
+	uint8_t* buf = new uint8_t[bytes];
+	if (buf == NULL) return ET_NotEnoughSpace;
+	delete[] m_pcmBuf;
+	m_pcmBuf = buf;
+	m_pcmBufSize = bytes;
+	return ET_NoErr;
+}
+
+int PusherHandler::resamplePCM(MediaFrame** frame, MediaFrame* resampled)
+{
+	if (m_pcmRate == 0 || m_pcmRate == m_mediaInfo.audioSamplerate) return ET_NoErr;
+	if (m_resampler == NULL) return ET_NotSupported; // no filter for the rates
+
+	uint32_t channels = (m_mediaInfo.audioChannel > 0) ? m_mediaInfo.audioChannel : 1;
+	size_t frames = (*frame)->frameLen / (sizeof(int16_t) * channels);
+	size_t samples = m_resampler->maxOutput(frames) * channels;
+	if (samples > m_rsBufSize)
+	{
+		int16_t* buf = new int16_t[samples];
+		if (buf == NULL) return ET_NotEnoughSpace;
+		delete[] m_rsBuf;
+		m_rsBuf = buf;
+		m_rsBufSize = samples;
+	}
+
+	size_t made = m_resampler->process((const int16_t*)(*frame)->frameData, frames, m_rsBuf);
+	*resampled = **frame;
+	resampled->frameData = (unsigned char*)m_rsBuf;
+	resampled->frameLen = made * channels * sizeof(int16_t);
+	*frame = resampled;
+	return ET_NoErr;
+}
+
+int PusherHandler::beginADPCM(MediaFrame* frame, const int16_t** pcm, uint8_t** out, uint32_t* samples)
+{
+	const int16_t* in = (const int16_t*)frame->frameData;
+	uint32_t n = frame->frameLen / sizeof(int16_t);
+	uint32_t total = n + (m_pcmCarried ? 1 : 0);
+	if (reservePCMBuffer(ImaAdpcmEncoder::kHeaderSize + total / 2) != ET_NoErr)
+		return ET_NotEnoughSpace;
+
+	// the state at the first sample that goes out with this frame
+	ImaAdpcmEncoder::writeHeader(m_adpcmState, m_pcmBuf);
+	m_pcmLen = ImaAdpcmEncoder::kHeaderSize;
+	m_pcmLeading = false;
+	if (m_pcmCarried && n > 0)
+	{
+		int16_t pair[2] = { m_pcmCarry, in[0] };
+		ImaAdpcmEncoder::encode(m_adpcmState, pair, m_pcmBuf + m_pcmLen, 2);
+		m_pcmLen++;
+		m_pcmLeading = true;
+		m_pcmCarried = false;
+		in++;
+		n--;
+	}
+	if (n & 1)
+	{
+		m_pcmCarry = in[n - 1];
+		m_pcmCarried = true;
+		n--;
+	}
+
+	*pcm = in;
+	*out = m_pcmBuf + m_pcmLen;
+	*samples = n;
+	m_pcmLen += n / 2;
+	return ET_NoErr;
+}
+
+int PusherHandler::pushEncoded(MediaFrame* frame)
+{
+	if (m_pcmLen == 0 || (encodesADPCM() && m_pcmLen == ImaAdpcmEncoder::kHeaderSize))
+		return ET_NoErr; // all of it waits for the next frame
+
+	MediaFrame encoded = *frame;
+	encoded.frameData = m_pcmBuf;
+	encoded.frameLen = m_pcmLen;
+	if (m_pcmLeading && m_mediaInfo.audioSamplerate > 0)
+	{
+		// it starts with the last frame's odd sample
+		uint64_t us = (uint64_t)frame->timestampSec * 1000000 + frame->timestampUsec;
+		uint64_t sampleUs = 1000000 / m_mediaInfo.audioSamplerate;
+		if (us >= sampleUs) us -= sampleUs;
+		encoded.timestampSec = (unsigned int)(us / 1000000);
+		encoded.timestampUsec = (unsigned int)(us % 1000000);
+	}
+	return pushFrame(&encoded);
+}
+
+int PusherHandler::setAsyncPush(bool enable, uint32_t ringBytes)
+{
+	if (!m_url.empty()) return -1; // the stream has been started
+
+	if (!enable)
+	{
+		delete m_frameRing;
+		m_frameRing = NULL;
+		return 0;
+	}
+
+	int ret = bindSharedEngine();
+	if (ret != 0) return ret;
+
+	FrameRing* ring = new FrameRing();
+	if (ring == NULL || ring->init(ringBytes > 0 ? ringBytes : (uint32_t)FrameRing::kDefaultCapacity) != 0)
+	{
+		delete ring;
+		return ET_NotEnoughSpace;
+	}
+	delete m_frameRing;
+	m_frameRing = ring;
+	return 0;
+}
+
+void PusherHandler::frameRingHandler(void* clientData, int /*mask*/)
+{
+	((PusherHandler*) clientData)->drainFrames();
+}
+
+void PusherHandler::drainFrames()
+{
+	m_frameRing->clearSignal();
+
+	MediaFrame frame;
+	int64_t enqueuedUs = 0;
+	int numFrames = 0;
+	do {
+		while (m_frameRing->peek(frame, &enqueuedUs))
+		{
+			// frames that come in while (re)connecting are dropped here
+			sendFrame(&frame, enqueuedUs);
+			m_frameRing->pop();
+
+			if (++numFrames == 256)
+			{
+				// let the other sessions on this loop have a turn
+				m_frameRing->signal();
+				return;
+			}
+		}
+	} while (!m_frameRing->idle());
+}
+
+int PusherHandler::sendFrame(MediaFrame* frame, int64_t enqueuedUs)
+{
+	if (frame == NULL) return ET_NotInPushingState;
+	if (m_state != kPushing)
+	{
+		m_stats.onDroppedNotPushing();
+		return ET_NotInPushingState;
+	}
+	uint32_t timestamp = 0;
+	int theErr = ET_NoErr;
+
+	uint32_t timestampIncrement = m_mediaInfo.audioSamplerate * frame->timestampSec;
+	timestampIncrement += (uint32_t) (m_mediaInfo.audioSamplerate *(frame->timestampUsec/1000000.0) + 0.5);
+	timestamp = m_timestampBase + timestampIncrement;
+	int64_t frameUs = (int64_t)frame->timestampSec * 1000000 + frame->timestampUsec;
+	int64_t durationUs = (int64_t)(frame->duration * 1000);
+
+	int status = 0;
+	uint32_t dropped = 0;
+	int64_t now = monotonicUs();
+	int64_t when = (enqueuedUs != 0) ? enqueuedUs : now;
+	pthread_mutex_lock(&m_sendLock);
+	if (m_state != kPushing)
+	{
+		// the connection went away meanwhile
+		pthread_mutex_unlock(&m_sendLock);
+		m_stats.onDroppedNotPushing();
+		return ET_NotInPushingState;
+	}
+
+	// one packet, several, or none yet while the frame is gathered with
+	// the next ones
+	if (!m_packetizer->addFrame((const char*)frame->frameData, frame->frameLen, timestamp, frameUs, durationUs, when))
+	{
+		pthread_mutex_unlock(&m_sendLock);
+		return ET_NotEnoughSpace;
+	}
+	bool needFlush = false;
+	RTPPacketizer::Packet pkt;
+	while ((theErr == ET_NoErr) && m_packetizer->nextPacket(pkt))
+	{
+		theErr = sendPacket(pkt, now, dropped, needFlush);
+		if (theErr == ET_NoErr)
+			m_rtcp.onRTPSent(pkt.timestamp, pkt.len, now);
+	}
+	if (theErr != ET_NoErr)
+		m_packetizer->dropFrame(); // the rest of it would be out of place
+	if ((theErr != ET_NoErr) && (theErr != ET_NotEnoughSpace))
+	{
+		status = m_rtspClient->GetStatus();
+		if (status == 200) status = errno;
+		if (status == 0) status = theErr;
+		m_state = kDone;
+		m_sendError = status;
+	}
+	pthread_mutex_unlock(&m_sendLock);
+
+	if (needFlush)
+		m_loop->requestFlush(this);
+
+	if (dropped > 0)
+	{
+		// over the latency budget: the oldest packets were dropped
+		m_pusherState = PUSHER_STATE_CONGESTED;
+		notifyProgress(m_pusherState, dropped, now);
+	}
+
+	if (theErr == ET_NotEnoughSpace)
+	{
+		// the queue is full: the connection has been stalled for a while
+		m_stats.onDroppedQueueFull();
+		return ET_NotEnoughSpace;
+	}
+	else if (theErr == ET_NoErr)
+	{
+		m_stats.onFrameSent();
+		m_pusherState = PUSHER_STATE_PUSHING;
+		notifyProgress(m_pusherState, 1, now);
+	}
+
+	if (theErr != ET_NoErr)
+	{
+		if (m_loop != NULL)
+		{
+			// the socket is owned by the engine thread: it reports the
+			// drop and reconnects
+			m_loop->post(this, PusherLoop::kCmdDisconnect);
+		}
+		else
+		{
+		    m_pusherState = PUSHER_STATE_ERROR;
+			//close socket        
+			delete m_socket; m_socket = NULL;
+			notify(m_pusherState, status);
+		}
+	}
+
+	return ET_NoErr;
+}
+
+int PusherHandler::setCallbackPolicy(uint32_t progressIntervalMs, bool notifierThread)
+{
+	if (!m_url.empty()) return -1; // the stream has been started
+
+	CallbackNotifier* notifier = NULL;
+	if (notifierThread)
+	{
+		notifier = CallbackNotifier::instance();
+		if (notifier == NULL) return -1;
+	}
+
+	m_notifier = notifier;
+	m_progressIntervalUs = (int64_t)progressIntervalMs * 1000;
+	return 0;
+}
+
+void PusherHandler::notify(RTSP_Pusher_State state, int code)
+{
+	if (m_callbackFunc == NULL) return;
+
+	if (m_progressIntervalUs > 0)
+		flushProgress();
+	deliver(state, code, true);
+}
+
+void PusherHandler::notifyProgress(RTSP_Pusher_State state, uint32_t count, int64_t now)
+{
+	if (m_callbackFunc == NULL) return;
+
+	if (m_progressIntervalUs <= 0)
+	{
+		deliver(state, (state == PUSHER_STATE_CONGESTED) ? (int)count : 0, false);
+		return;
+	}
+
+	__atomic_fetch_add((state == PUSHER_STATE_CONGESTED) ? &m_progressDropped : &m_progressFrames, 
+			count, __ATOMIC_RELAXED);
+
+	// whoever moves m_lastProgressUs on reports the interval
+	int64_t last = __atomic_load_n(&m_lastProgressUs, __ATOMIC_RELAXED);
+	if ((now - last >= m_progressIntervalUs)
+			&& __atomic_compare_exchange_n(&m_lastProgressUs, &last, now, false, 
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		flushProgress();
+}
+
+void PusherHandler::flushProgress()
+{
+	uint32_t dropped = __atomic_exchange_n(&m_progressDropped, 0, __ATOMIC_RELAXED);
+	uint32_t frames = __atomic_exchange_n(&m_progressFrames, 0, __ATOMIC_RELAXED);
+	if (dropped > 0)
+		deliver(PUSHER_STATE_CONGESTED, (int)dropped, false);
+	if (frames > 0)
+		deliver(PUSHER_STATE_PUSHING, (int)frames, false);
+}
+
+void PusherHandler::deliver(RTSP_Pusher_State state, int code, bool mustDeliver)
+{
+	if (m_notifier != NULL)
+		m_notifier->post(m_callbackFunc, state, code, m_cbParam, mustDeliver);
+	else
+		m_callbackFunc(state, code, m_cbParam);
+}
+
+int PusherHandler::sendPacket(const RTPPacketizer::Packet& pkt, int64_t now, uint32_t& dropped, bool& needFlush)
+{
+	// The interleaved prefix and the RTP header are built here; the payload
+	// goes out from where the packetizer has it.
+	char hdr[4 + RTP_HDR_SZ] = {0};
+	uint32_t len = RTP_HDR_SZ + pkt.len;
+
+	RTPPacket rtpPkt(hdr + 4, RTP_HDR_SZ);
+	rtpPkt.SetRtpHeader(m_mediaInfo.audioCodec, true);
+	rtpPkt.SetSeqNum(++m_rtpSeq);
+	rtpPkt.SetTimeStamp(pkt.timestamp);
+	rtpPkt.SetSSRC(m_ssrc);
+
+	hdr[0] = '$';
+	hdr[1] = 0;
+	hdr[2] = (char)((len >> 8) & 0xFF);
+	hdr[3] = (char)(len & 0xFF);
+
+	// over UDP the RTP packet is the datagram, without the interleaved prefix
+	uint32_t prefix = (m_connType == RTP_OVER_UDP) ? 4 : 0;
+	struct iovec iov[3];
+	iov[0].iov_base = hdr + prefix;
+	iov[0].iov_len = sizeof(hdr) - prefix;
+	for (int i = 0; i < pkt.iovcnt; i++)
+		iov[1 + i] = pkt.iov[i];
+	int iovcnt = 1 + pkt.iovcnt;
+	int64_t when = pkt.when;
+
+	int theErr = ET_NoErr;
+	if ((m_loop != NULL) && m_loop->sendBatching())
+	{
+		// the loop writes the whole batch out with one writev
+		theErr = queuePacket(iov, iovcnt, when, now, dropped);
+		if ((theErr == ET_NoErr) && !m_writePending && !m_flushQueued)
+			m_flushQueued = needFlush = true;
+	}
+	else if (m_sendQueue.empty() && !m_writePending)
+	{
+		// nothing waiting: write straight from the frame, and copy only
+		// what the socket didn't take
+		uint32_t sent = 0;
+		theErr = writePacket(iov, iovcnt, &sent);
+		if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+		{
+			sent = 0;
+			theErr = ET_NoErr;
+		}
+		if (theErr == ET_NoErr)
+		{
+			if (sent > 0) m_stats.onBytesSent(sent);
+			if (sent == iov[0].iov_len + pkt.len)
+			{
+				m_stats.onPacketSent(now - when);
+			}
+			else
+			{
+				if (sent > 0) m_stats.onPartialWrite();
+				m_sendQueue.pushRemainder(iov, iovcnt, sent, when);
+				theErr = EAGAIN;
+			}
+		}
+	}
+	else
+	{
+		// Queue behind the rest, so a packet that doesn't fit in the socket
+		// buffer now goes out later instead of being lost. While the loop is
+		// waiting for the socket to drain, leave the writing to it.
+		theErr = queuePacket(iov, iovcnt, when, now, dropped);
+		if ((theErr == ET_NoErr) && !m_writePending)
+			theErr = flushQueue();
+	}
+
+	if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+	{
+		theErr = ET_NoErr;
+		if ((m_loop != NULL) && !m_writePending)
+		{
+			m_writePending = true;
+			m_loop->post(this, PusherLoop::kCmdWantWrite);
+		}
+	}
+	return theErr;
+}
+
+int PusherHandler::setPacketization(uint32_t mtu, uint32_t ptimeMs)
+{
+	int ret = 0;
+	pthread_mutex_lock(&m_sendLock);
+	m_mtu = mtu;
+	m_ptimeMs = ptimeMs;
+	if (m_packetizer != NULL)
+		ret = m_packetizer->setLimits(mtu, ptimeMs * 1000);
+	pthread_mutex_unlock(&m_sendLock);
+	return ret;
+}
+
+int PusherHandler::setSendQueueLimits(uint32_t maxPackets, uint32_t maxBytes)
+{
+	if (maxPackets == 0 || maxBytes == 0) return -1;
+
+	pthread_mutex_lock(&m_sendLock);
+	m_sendQueue.setLimits(maxPackets, maxBytes);
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
+
+int PusherHandler::setLatencyBudget(uint32_t maxLatencyMs)
+{
+	pthread_mutex_lock(&m_sendLock);
+	m_maxLatencyUs = (int64_t)maxLatencyMs * 1000;
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
+
+int PusherHandler::getSendQueueStatus(uint32_t* packets, uint32_t* bytes, uint32_t* dropped)
+{
+	pthread_mutex_lock(&m_sendLock);
+	if (packets != NULL) *packets = m_sendQueue.packets();
+	if (bytes != NULL) *bytes = m_sendQueue.bytes();
+	if (dropped != NULL) *dropped = m_droppedPackets;
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
+
+int PusherHandler::setUDPSegmentation(bool enable)
+{
+	pthread_mutex_lock(&m_sendLock);
+	m_udpSegmentation = enable;
+	if (m_rtpSocket != NULL)
+		m_rtpSocket->SetSegmentation(enable);
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
+
+int PusherHandler::setZeroCopy(bool enable)
+{
+	pthread_mutex_lock(&m_sendLock);
+	m_zeroCopy = enable;
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
+
+int PusherHandler::queuePacket(const struct iovec* iov, int iovcnt, int64_t when, int64_t now, uint32_t& dropped)
+{
+	if (m_maxLatencyUs <= 0)
+		return m_sendQueue.push(iov, iovcnt, when);
+
+	// drop-oldest: whatever has waited past the budget would only add
+	// latency, and so would keeping old packets instead of the new one
+	uint32_t n = m_sendQueue.dropOlderThan(now - m_maxLatencyUs);
+	int theErr = m_sendQueue.push(iov, iovcnt, when);
+	while ((theErr == ET_NotEnoughSpace) && (m_sendQueue.dropOldest(1) == 1))
+	{
+		n++;
+		theErr = m_sendQueue.push(iov, iovcnt, when);
+	}
+	m_droppedPackets += n;
+	dropped += n;
+	if (n > 0) m_stats.onDroppedLatency(n);
+	return theErr;
+}
+
+PusherHandler::PusherHandler()
+	: m_callbackFunc(NULL), m_cbParam(NULL), m_notifier(NULL), m_progressIntervalUs(0),
+	m_progressFrames(0), m_progressDropped(0), m_lastProgressUs(0), m_engine(NULL), m_loop(NULL), m_rtspClient(NULL),
+	m_socket(NULL), m_connType(RTP_OVER_TCP), m_rtpSocket(NULL), m_rtcpSocket(NULL), 
+	m_udpSegmentation(false), m_zeroCopy(false), m_reconn(0), m_retries(0), m_closing(false),
+	m_randSeed(0), m_serverAddr(0), m_serverPort(0), m_sdp(NULL), 
+	m_state(kSendingOptions), m_rtpSeq(0), 
+	m_pusherState(PUSHER_STATE_CONNECTING), m_ssrc(0), m_timestampBase(0),
+	m_writePending(false), m_sendError(0), m_flushQueued(false), m_ioSlot(-1), m_teardownPending(false),
+	m_maxLatencyUs(0), m_droppedPackets(0), m_packetizer(NULL),
+	m_mtu(RTPPacketizer::kDefaultMTU), m_ptimeMs(0), m_pcmBuf(NULL), m_pcmBufSize(0), m_pcmLen(0), m_pcmLeading(false),
+	m_pcmCarry(0), m_pcmCarried(false), m_pcmRate(0), m_resampler(NULL), m_rsBuf(NULL), m_rsBufSize(0),
+	m_requestTimer(NULL), m_reconnectTimer(NULL), m_rtcpTimer(NULL), m_frameRing(NULL),
+	m_holdsConnectSlot(false), m_releaseWait(NULL)
+{
+	pthread_mutex_init(&m_sendLock, NULL);
+	pthread_mutex_init(&m_pcmLock, NULL);
+	m_adpcmState.predictor = 0;
+	m_adpcmState.index = 0;
+	m_sendQueue.setStats(&m_stats);
+
+	// many handlers are created within the same second when running on an
+	// engine, so mix the object address into the seed. The SSRC and the
+	// timestamp base are kept across reconnects.
+	m_randSeed = (unsigned)time(NULL) ^ (unsigned)(uintptr_t)this;
+	m_ssrc = rand_r(&m_randSeed);
+	m_timestampBase = rand_r(&m_randSeed);
+}
+
+PusherHandler::~PusherHandler()
+{
+	delete m_packetizer;
+	delete[] m_pcmBuf;
+	delete m_resampler;
+	delete[] m_rsBuf;
+	pthread_mutex_destroy(&m_pcmLock);
+	pthread_mutex_destroy(&m_sendLock);
+}
+
+void PusherHandler::onStart()
+{
+	signal(SIGPIPE, SIG_IGN);
+	if (m_frameRing != NULL)
+	{
+		m_loop->scheduler().setBackgroundHandling(m_frameRing->signalFd(), SOCKET_READABLE, 
+				(TaskScheduler::BackgroundHandlerProc*) &frameRingHandler, this);
+	}
+	connect();
+}
+
+void PusherHandler::onClose()
+{
+	m_closing = true;
+	cancelReport();
+	if (m_state != kPushing)
+	{
+		// handshaking, dropped or waiting to reconnect: just stop
+		cancelRequestTimer();
+		m_loop->scheduler().unscheduleDelayedTask(m_reconnectTimer);
+		releaseConnectSlot();
+		setSocketHandling(false);
+		m_state = kDone;
+		return;
+	}
+
+	if (m_ioSlot >= 0)
+	{
+		// TEARDOWN must not overtake the packets being written
+		m_teardownPending = true;
+		return;
+	}
+
+	setSocketHandling(false);
+	teardown();
+}
+
+void PusherHandler::onDisconnect()
+{
+	pthread_mutex_lock(&m_sendLock);
+	int err = m_sendError;
+	m_sendError = 0;
+	pthread_mutex_unlock(&m_sendLock);
+
+	// zero if the loop noticed the drop first
+	if (err != 0 && m_socket != NULL)
+		connectionAborted(err);
+}
+
+void PusherHandler::onRelease()
+{
+	ReleaseWait* wait = m_releaseWait;
+	setSocketHandling(false);
+	destroy();
+
+	if (wait != NULL)
+	{
+		pthread_mutex_lock(&wait->lock);
+		wait->done = true;
+		pthread_cond_signal(&wait->cond);
+		pthread_mutex_unlock(&wait->lock);
+	}
+}
+
+void PusherHandler::onWantWrite()
+{
+	if (m_state == kPushing)
+		setSocketHandling(true);
+}
+
+void PusherHandler::onFlush()
+{
+	ET_Error theErr = ET_NoErr;
+	// io_uring carries the interleaved TCP stream; datagrams keep sendmmsg
+	IoUringSender* ring = (m_rtpSocket == NULL) ? m_loop->ioUring() : NULL;
+
+	pthread_mutex_lock(&m_sendLock);
+	m_flushQueued = false;
+	if ((m_state == kPushing) && !m_writePending)
+	{
+		theErr = (ring != NULL) ? submitQueue(ring) : flushQueue();
+		if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+			m_writePending = true;
+	}
+	pthread_mutex_unlock(&m_sendLock);
+
+	if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+		setSocketHandling(true); // the rest goes out when the socket drains
+	else if (theErr != ET_NoErr)
+		connectionAborted(theErr);
+}
+
+ET_Error PusherHandler::submitQueue(IoUringSender* ring)
+{
+	// one write at a time keeps the stream in order; the rest goes when
+	// it completes
+	if (m_ioSlot >= 0 || m_sendQueue.empty())
+		return ET_NoErr;
+
+	int slot = ring->acquireBuffer();
+	if (slot < 0)
+		return flushQueue(); // the pool is used up: write it directly
+
+	uint32_t len = m_sendQueue.take(ring->buffer(slot), ring->bufferSize());
+	ring->queueWrite(slot, m_socket->GetSocket()->GetSocketFD(), len, writeDoneHandler, this);
+	m_ioSlot = slot;
+	return ET_NoErr;
+}
+
+void PusherHandler::writeDoneHandler(void* clientData, int result)
+{
+	((PusherHandler*) clientData)->onWriteDone(result);
+}
+
+void PusherHandler::onWriteDone(int result)
+{
+	m_ioSlot = -1;
+	if (result < 0)
+	{
+		connectionAborted(-result);
+		return;
+	}
+
+	if (m_teardownPending)
+	{
+		m_teardownPending = false;
+		setSocketHandling(false);
+		teardown();
+		return;
+	}
+
+	pthread_mutex_lock(&m_sendLock);
+	bool more = (m_state == kPushing) && !m_sendQueue.empty() && !m_flushQueued;
+	if (more) m_flushQueued = true;
+	pthread_mutex_unlock(&m_sendLock);
+
+	if (more)
+		m_loop->requestFlush(this);
+}
+
+void PusherHandler::detachWrite()
+{
+	if (m_ioSlot < 0) return;
+
+	m_loop->ioUringSender()->detach(m_ioSlot);
+	m_ioSlot = -1;
+	m_teardownPending = false;
+}
+
+void PusherHandler::setSocketHandling(bool enable)
+{
+	if (m_loop == NULL || m_socket == NULL) return;
+
+	TaskScheduler& scheduler = m_loop->scheduler();
+	int fd = m_socket->GetSocket()->GetSocketFD();
+	if (enable)
+	{
+		pthread_mutex_lock(&m_sendLock);
+		bool writePending = m_writePending;
+		pthread_mutex_unlock(&m_sendLock);
+
+		int conditionSet = SOCKET_READABLE|SOCKET_EXCEPTION|SOCKET_EDGE_TRIGGERED;
+		if (writePending && m_rtpSocket == NULL) conditionSet |= SOCKET_WRITABLE;
+		scheduler.setBackgroundHandling(fd, conditionSet, 
+				(TaskScheduler::BackgroundHandlerProc*) &socketHandler, this);
+
+		// over UDP the packets wait for the RTP socket instead, which is
+		// only watched while they are backed up
+		if (m_rtpSocket != NULL)
+		{
+			int rtpFd = m_rtpSocket->GetSocketFD();
+			if (writePending)
+				scheduler.setBackgroundHandling(rtpFd, SOCKET_WRITABLE|SOCKET_EDGE_TRIGGERED, 
+						(TaskScheduler::BackgroundHandlerProc*) &socketHandler, this);
+			else
+				scheduler.disableBackgroundHandling(rtpFd);
+
+			scheduler.setBackgroundHandling(m_rtcpSocket->GetSocketFD(), SOCKET_READABLE, 
+					(TaskScheduler::BackgroundHandlerProc*) &rtcpSocketHandler, this);
+		}
+	}
+	else
+	{
+		scheduler.disableBackgroundHandling(fd);
+		if (m_rtpSocket != NULL)
+		{
+			scheduler.disableBackgroundHandling(m_rtpSocket->GetSocketFD());
+			scheduler.disableBackgroundHandling(m_rtcpSocket->GetSocketFD());
+		}
+	}
+}
+
+void PusherHandler::socketHandler(void* clientData, int mask)
+{
+	((PusherHandler*) clientData)->socketHandler(mask);
+}
+
+void PusherHandler::socketHandler(int mask)
 {
-	return new PusherHandler();
+	// zero copy completions come in on the error queue, reported as readable
+	if ((mask & (SOCKET_READABLE|SOCKET_EXCEPTION)) && m_rtpSocket == NULL)
+		reapZeroCopy();
+
+	if ((mask & SOCKET_WRITABLE) && !handleWritable())
+		return;
+
+	if (mask & (SOCKET_READABLE|SOCKET_EXCEPTION))
+		handleReadable();
 }
 
-int PusherHandler::setCallbackFunc(PusherCallback cb, void* cbParam)
-{
-	m_callbackFunc = cb;
-	m_cbParam = cbParam;
-	return 0;
+bool PusherHandler::handleWritable()
+{
+	pthread_mutex_lock(&m_sendLock);
+	ET_Error theErr = flushQueue();
+	if (theErr == ET_NoErr) m_writePending = false;
+	pthread_mutex_unlock(&m_sendLock);
+
+	if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+		return true; // still backed up, wait for the next edge
+
+	if (theErr != ET_NoErr)
+	{
+		connectionAborted(theErr);
+		return false;
+	}
+
+	// drained: stop watching for writability
+	setSocketHandling(true);
+	return true;
 }
 
-int PusherHandler::startStream(const char* url, 
-	                                RTP_ConnectType connType, 
-	                                const char* username,
-		                            const char* password, 
-		                            int reconn, 
-		                            const MediaInfo& mi)
+void PusherHandler::handleReadable()
 {
-	int ret = 0;
+	char buf[2048];
+	uint32_t rcvLen = 0;
+	ET_Error theErr = ET_NoErr;
 
-	char addr[32] = {0};
-	int port = 0;
+	// nothing is expected from the server while pushing, drain whatever
+	// arrives so the socket never fills up and notice when it goes away.
+	// The socket is edge triggered, so read until EAGAIN.
+	do {
+		rcvLen = 0;
+		theErr = m_socket->GetSocket()->Read(buf, sizeof(buf), &rcvLen);
+		if (theErr == ET_NoErr)
+			parseInterleaved(buf, rcvLen);
+	} while (theErr == ET_NoErr);
 
-	if (m_rtspClient == NULL)
+	if (theErr == EAGAIN) return;
+
+	connectionAborted(theErr);
+}
+
+void PusherHandler::reapZeroCopy()
+{
+	Socket* sock = m_socket->GetSocket();
+	pthread_mutex_lock(&m_sendLock);
+	if (m_sendQueue.zeroCopyPending())
 	{
-		char *tuser = NULL, *tpasswd = NULL;	
-		ret = parseDetailRTSPURL(url, tuser, tpasswd, &addr[0], &port);
-		if (ret < 0) return ret;
+		uint32_t first, last;
+		while (sock->ReapZeroCopy(&first, &last) == ET_NoErr)
+			m_sendQueue.releaseZeroCopy(first, last);
+	}
+	pthread_mutex_unlock(&m_sendLock);
+}
 
-		m_socket = new TCPClientSocket(Socket::kNonBlockingSocketType);
-		uint32_t ipAddr = (uint32_t)ntohl(::inet_addr(addr));
-		m_socket->Set(ipAddr, port);
-		m_rtspClient = new MyDarwin::RTSPClient(m_socket);
-		m_rtspClient->Set((char*)url);
+void PusherHandler::parseInterleaved(const char* data, uint32_t len)
+{
+	m_rxBuf.append(data, len);
 
-		if (tuser != NULL)
-		{
-			m_rtspClient->SetName(tuser);
-			delete[] tuser;
-			
-		}
-		if (tpasswd != NULL)
-		{
-			m_rtspClient->SetPassword(tpasswd);
-			delete[] tpasswd;
-		}
-	
-		if (username != NULL)
+	size_t pos = 0;
+	while (pos < m_rxBuf.size())
+	{
+		const char* p = m_rxBuf.data() + pos;
+		size_t left = m_rxBuf.size() - pos;
+		if (p[0] == '$')
 		{
-			m_rtspClient->SetName((char*)username);
+			// '$', channel, 16 bit length, then the packet
+			if (left < 4) break;
+			size_t pktLen = ((size_t)(unsigned char)p[2] << 8) | (unsigned char)p[3];
+			if (left < 4 + pktLen) break;
+
+			if (p[1] == 1)
+			{
+				pthread_mutex_lock(&m_sendLock);
+				m_rtcp.parse(p + 4, (uint32_t)pktLen);
+				pthread_mutex_unlock(&m_sendLock);
+			}
+			pos += 4 + pktLen;
+			continue;
 		}
 
-		if (password != NULL)
+		// an RTSP message (or the rest of one): skip its headers and body
+		size_t end = m_rxBuf.find("\r\n\r\n", pos);
+		if (end == std::string::npos) break;
+
+		size_t bodyLen = 0;
+		for (size_t line = pos; line < end; )
 		{
-			m_rtspClient->SetPassword((char*)password);
+			size_t next = m_rxBuf.find("\r\n", line);
+			if (::strncasecmp(m_rxBuf.data() + line, "Content-Length:", 15) == 0)
+				bodyLen = (size_t)::atoi(m_rxBuf.data() + line + 15);
+			line = next + 2;
 		}
+		if (m_rxBuf.size() < end + 4 + bodyLen) break;
+		pos = end + 4 + bodyLen;
 	}
-	else
-	{
-		// is running.
-		return ret;
-	}
-
-    //����SDP
-	m_connType = connType;
-	memcpy(&m_mediaInfo, &mi, sizeof(mi));
-	ret = generateSDPString(addr, mi);
+	m_rxBuf.erase(0, pos);
 
-    m_state = kSendingOptions;
-	return SetupStream();
+	// nothing we can make sense of: start over with what comes next
+	if (m_rxBuf.size() > RX_BUF_MAX)
+		m_rxBuf.clear();
 }
 
-int PusherHandler::closeStream()
+void PusherHandler::scheduleReport(bool first)
 {
-    int theErr = ET_NoErr;
+	if (m_loop == NULL) return;
 
-    if (m_state != kSendingTeardown)
-    {
-	    m_state = kSendingTeardown;
-		if (m_rtspClient != NULL )
-		{
-            theErr = m_rtspClient->SendTeardown();
-            if (theErr == ET_NoErr)
-            {
-                m_state = kDone;
-                m_pusherState = PUSHER_STATE_DISCONNECTED;
-			    if (m_callbackFunc != NULL) 
-				    m_callbackFunc(m_pusherState, 0, m_cbParam);
+	m_rtcpTimer = m_loop->scheduler().scheduleDelayedTask(m_rtcp.nextReportDelayUs(&m_randSeed, first), 
+			(TaskFunc*) &reportHandler, this);
+}
 
-			return 0;
-            }
-		}
-    }
+void PusherHandler::cancelReport()
+{
+	if (m_loop != NULL)
+		m_loop->scheduler().unscheduleDelayedTask(m_rtcpTimer);
+}
 
-	return -1;
+void PusherHandler::reportHandler(void* clientData)
+{
+	((PusherHandler*) clientData)->sendReport();
 }
 
-int PusherHandler::release() 
+void PusherHandler::sendReport()
 {
-	if (m_rtspClient != NULL)
+	m_rtcpTimer = NULL;
+	if (m_state != kPushing) return;
+
+	char pkt[4 + RTCPSession::kMaxPacketSize];
+	ET_Error theErr = ET_NoErr;
+	bool needFlush = false;
+
+	pthread_mutex_lock(&m_sendLock);
+	uint32_t len = m_rtcp.buildSenderReport(pkt + 4, RTCPSession::kMaxPacketSize);
+	if (len > 0)
 	{
-		delete m_rtspClient;
-		m_rtspClient = NULL;
+		struct iovec iov;
+		if (m_rtcpSocket != NULL)
+		{
+			// a report that doesn't make it is replaced by the next one
+			iov.iov_base = pkt + 4;
+			iov.iov_len = len;
+			m_rtcpSocket->SendV(&iov, 1);
+		}
+		else
+		{
+			// interleaved channel 1, behind the RTP packets already queued
+			pkt[0] = '$';
+			pkt[1] = 1;
+			pkt[2] = (char)((len >> 8) & 0xFF);
+			pkt[3] = (char)(len & 0xFF);
+			iov.iov_base = pkt;
+			iov.iov_len = 4 + len;
+			if ((m_sendQueue.push(&iov, 1, monotonicUs()) == ET_NoErr) && !m_writePending && !m_flushQueued)
+			{
+				if (m_loop->sendBatching())
+					m_flushQueued = needFlush = true;
+				else
+					theErr = flushQueue();
+			}
+		}
 	}
+	if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+		m_writePending = true;
+	pthread_mutex_unlock(&m_sendLock);
 
-	if (m_sdp != NULL)
+	if (needFlush)
+		m_loop->requestFlush(this);
+
+	if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
 	{
-		delete[] m_sdp;
-		m_sdp = NULL;
+		setSocketHandling(true);
+	}
+	else if (theErr != ET_NoErr)
+	{
+		connectionAborted(theErr);
+		return;
 	}
 
-	m_rtpSeq = 0;
-    delete this; 
-    return 0; 
+	scheduleReport(false);
 }
 
-int PusherHandler::pushFrame(MediaFrame* frame)
+void PusherHandler::rtcpSocketHandler(void* clientData, int /*mask*/)
 {
-	if (frame == NULL || m_state != kPushing) return ET_NotInPushingState;
-	char buf[1500] = {0};
-    uint32_t len = sizeof(buf);
-	uint32_t timestamp = 0;
-    int readSz = RTP_HDR_SZ;
-	int theErr = ET_NoErr;
-
-#if 0
-	MediaFrame* mframe = new MediaFrame;
-	if (mframe == NULL) return ET_NotEnoughSpace;
+	((PusherHandler*) clientData)->readRTCPSocket();
+}
 
-	mframe->frameData = new uint8_t[frame->frameLen+4];
-	if (mframe->frameData == NULL) 
+void PusherHandler::readRTCPSocket()
+{
+	char buf[1500];
+	uint32_t len = 0;
+	uint32_t fromAddr = 0;
+	while (m_rtcpSocket->RecvFrom(buf, sizeof(buf), &len, &fromAddr) == ET_NoErr)
 	{
-		delete mframe;
-		return ET_NotEnoughSpace;
+		if (fromAddr != m_serverAddr) continue;
+
+		pthread_mutex_lock(&m_sendLock);
+		m_rtcp.parse(buf, len);
+		pthread_mutex_unlock(&m_sendLock);
 	}
+}
+
+int PusherHandler::getRTCPStats(RTCPStats* stats)
+{
+	if (stats == NULL) return -1;
 
-	::memset(mframe->frameData, 0, 4);
-	::memcpy(mframe->frameData+4, frame->frameData, frame->frameLen);
-	mframe->frameLen = frame->frameLen+4;
-	mframe->timestampSec = frame->timestampSec;
-	mframe->timestampUsec = frame->timestampUsec;
-    mframe->duration = frame->duration;
-#endif
+	pthread_mutex_lock(&m_sendLock);
+	m_rtcp.getStats(stats);
+	pthread_mutex_unlock(&m_sendLock);
+	return 0;
+}
 
-    ::memcpy(buf + readSz + 4, frame->frameData, frame->frameLen);
-	readSz += frame->frameLen + 4;
-	uint32_t timestampIncrement = m_mediaInfo.audioSamplerate * frame->timestampSec;
-	timestampIncrement += (uint32_t) (m_mediaInfo.audioSamplerate *(frame->timestampUsec/1000000.0) + 0.5);
-	timestamp = m_timestampBase + timestampIncrement;
+int PusherHandler::getStats(PusherStats* stats)
+{
+	if (stats == NULL) return -1;
 
-	len = readSz;
-	RTPPacket rtpPkt(buf, len);
-	rtpPkt.SetRtpHeader(m_mediaInfo.audioCodec, true);
-	rtpPkt.SetSeqNum(++m_rtpSeq);
-	rtpPkt.SetTimeStamp(timestamp);
-	rtpPkt.SetSSRC(m_ssrc);
+	m_stats.getStats(stats);
+	return 0;
+}
 
-	bool getNext = true;
-	do {
-		theErr = m_rtspClient->SendInterleavedWrite(0, len, buf, &getNext);
-		
-		if (theErr != ET_NoErr)
-		{
-			if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
-			{
-				m_socket->GetSocket()->RequestEvent(EV_WR);
-				//printf("lost fream"); 				
-				theErr = ET_NoErr;
-			}
-			break;
-		}
-		else
-		{
-			m_pusherState = PUSHER_STATE_PUSHING;
-			if (m_callbackFunc != NULL) 
-				m_callbackFunc(m_pusherState, 0, m_cbParam);
-		}
-	}while (!getNext);
+void PusherHandler::connectionAborted(int err)
+{
+	closeConnection();
 
-	if (theErr != ET_NoErr)
+	int64_t retryDelay = nextRetryDelay();
+	m_state = (retryDelay < 0) ? kDone : kWaitingReconnect;
+	m_pusherState = PUSHER_STATE_CONNECT_ABORT;
+	notify(m_pusherState, err);
+
+	if (retryDelay >= 0)
+		scheduleConnect(retryDelay);
+}
+
+void PusherHandler::connect()
+{
+	if (m_closing) return;
+
+	// at most so many handshakes in flight per engine, so that a server
+	// coming back isn't hit by all of its streams at once
+	if (!m_holdsConnectSlot && m_engine != NULL)
 	{
-	    m_pusherState = PUSHER_STATE_ERROR;
-		//close socket        
-		delete m_socket; m_socket = NULL;
-		if (m_callbackFunc != NULL)
+		if (!m_engine->acquireConnectSlot())
 		{
-		    int status = m_rtspClient->GetStatus();
-			if (status == 200) status = errno;
-			m_callbackFunc(m_pusherState, status, m_cbParam);
+			m_state = kWaitingReconnect;
+			scheduleConnect((CONNECT_SLOT_RETRY_MS + rand_r(&m_randSeed) % CONNECT_SLOT_RETRY_MS) * 1000);
+			return;
 		}
+		m_holdsConnectSlot = true;
 	}
 
-	return ET_NoErr;
+	if (m_rtspClient == NULL)
+		createConnection();
+	m_state = kSendingOptions;
+	startHandshake();
 }
 
-PusherHandler::PusherHandler()
-	: m_callbackFunc(NULL), m_cbParam(NULL), m_tid(0), m_rtspClient(NULL),
-	m_socket(NULL), m_connType(RTP_OVER_TCP), m_sdp(NULL), 
-	m_state(kSendingOptions), m_rtpSeq(0), 
-	m_pusherState(PUSHER_STATE_CONNECTING), m_ssrc(0), m_timestampBase(0)
+void PusherHandler::reconnectHandler(void* clientData)
 {
-	srand((unsigned)time(NULL));
-	m_ssrc = rand();
-	m_timestampBase = rand();
+	PusherHandler* hdr = (PusherHandler*) clientData;
+	hdr->m_reconnectTimer = NULL;
+	hdr->connect();
 }
 
-PusherHandler::~PusherHandler()
+void PusherHandler::scheduleConnect(int64_t delayUs)
+{
+	TaskScheduler& scheduler = m_loop->scheduler();
+	scheduler.unscheduleDelayedTask(m_reconnectTimer);
+	m_reconnectTimer = scheduler.scheduleDelayedTask(delayUs, reconnectHandler, this);
+}
+
+void PusherHandler::releaseConnectSlot()
+{
+	if (m_holdsConnectSlot)
+	{
+		m_engine->releaseConnectSlot();
+		m_holdsConnectSlot = false;
+	}
+}
+
+int64_t PusherHandler::nextRetryDelay()
 {
+	if (m_closing) return -1;
+	if (m_reconn > 0 && m_retries >= m_reconn) return -1;
+
+	int shift = (m_retries < 16) ? m_retries : 16;
+	m_retries++;
+
+	int64_t ceiling = (int64_t)RECONNECT_MIN_DELAY_MS << shift;
+	if (ceiling > RECONNECT_MAX_DELAY_MS) ceiling = RECONNECT_MAX_DELAY_MS;
+
+	// half of it fixed, half random: keeps backing off, while streams that
+	// dropped together spread out
+	int64_t half = ceiling * 1000 / 2;
+	return half + rand_r(&m_randSeed) % (half + 1);
 }
 
 ET_Error PusherHandler::SetupStream()
 {
 	signal(SIGPIPE, SIG_IGN);
+
 	int theErr = ET_NoErr;
-	
-	if (m_callbackFunc != NULL)
+
+	m_pusherState = PUSHER_STATE_CONNECTING;
+	notify(m_pusherState, 0);
+
+	while ((theErr == ET_NoErr) && (m_state < kPushing))
 	{
-		m_pusherState = PUSHER_STATE_CONNECTING;
-		m_callbackFunc(m_pusherState, 0, m_cbParam);
+		theErr = handshakeStep();
+
+		if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
+		{
+			uint32_t em = m_socket->GetEventMask();
+			theErr = m_socket->GetSocket()->RequestEvent(em);
+		}
 	}
 
-    bool endLoop = false;
-	while ((theErr == ET_NoErr) && (m_state != kDone) && (!endLoop))
+	if (m_state == kPushing)
+		return 0;
+
+	// one attempt: backing off here would hold the caller's thread with
+	// nothing to interrupt it; the event loop paths retry
+	handshakeFailed(theErr, false);
+	return -1;
+}
+
+ET_Error PusherHandler::handshakeStep()
+{
+	ET_Error theErr = ET_NoErr;
+
+	switch(m_state)
 	{
-		switch(m_state)
+		case kSendingOptions:
 		{
-			case kSendingOptions:
+			theErr = m_rtspClient->SendOptions();
+			if (theErr == ET_NoErr)
 			{
-				theErr = m_rtspClient->SendOptions();
-				if (theErr == ET_NoErr)
-				{
-					if (m_rtspClient->GetStatus() != 200)
-					{
-						theErr = ENOTCONN;
-						break;
-					}
-					else
-					{
-						m_state = kSendingAnnounce;
-					}
-				}
-				break;
+				if (m_rtspClient->GetStatus() != 200)
+					theErr = ENOTCONN;
+				else
+					m_state = kSendingAnnounce;
+			}
+			break;
+		}
+		case kSendingAnnounce:
+		{
+			theErr = m_rtspClient->SendAnnounce(m_sdp);
+			if (theErr == ET_NoErr)
+			{
+				if (m_rtspClient->GetStatus() != 200)
+					theErr = ENOTCONN;
+				else
+					m_state = kSendingSetup;
+			}
+			break;
+		}
+		case kSendingSetup:
+		{
+			if (m_connType == RTP_OVER_TCP)
+			{
+				theErr = m_rtspClient->SendTCPSetup(1, 0, 1);
 			}
-			case kSendingAnnounce:
+			else
 			{
-				theErr = m_rtspClient->SendAnnounce(m_sdp);
+				// the ports are bound once; the request may take several calls
+				if (m_rtpSocket == NULL)
+					theErr = openUDPPorts();
 				if (theErr == ET_NoErr)
-				{
-					if (m_rtspClient->GetStatus() != 200)
-					{
-						theErr = ENOTCONN;
-						break;
-					}
-					else
-					{
-						m_state = kSendingSetup;
-					}
-				}
-				break;
+					theErr = m_rtspClient->SendUDPSetup(1, m_rtpSocket->GetLocalPort());
 			}
-			case kSendingSetup:
+				
+			if (theErr == ET_NoErr)
 			{
-				if (m_connType == RTP_OVER_TCP)
+				if (m_rtspClient->GetStatus() != 200)
 				{
-					theErr = m_rtspClient->SendTCPSetup(1, 0, 1);
+					theErr = ENOTCONN;
 				}
-					
-				if (theErr == ET_NoErr)
+				else if (m_connType == RTP_OVER_UDP)
 				{
-					if (m_rtspClient->GetStatus() != 200)
+					// the server's ports come with the answer: RTP, and RTCP above it
+					uint16_t serverPort = m_rtspClient->GetServerPort();
+					if (serverPort == 0)
 					{
 						theErr = ENOTCONN;
 						break;
 					}
-					else
-					{
-						m_state = kSendingPlay;
-					}
+					m_rtpSocket->SetDestination(m_serverAddr, serverPort);
+					m_rtcpSocket->SetDestination(m_serverAddr, serverPort + 1);
+					m_state = kSendingPlay;
+				}
+				else
+				{
+					m_state = kSendingPlay;
 				}
-				break;
 			}
-			case kSendingPlay:
+			break;
+		}
+		case kSendingPlay:
+		{
+			theErr = m_rtspClient->SendPlay(0);
+			printf("after send play, theErr = %d.\n", theErr);
+
+			// Not every server answers PLAY on a pushed session: once the
+			// request is out, start pushing. A late answer is drained
+			// with whatever else the server sends while we push.
+			if ((theErr == EINPROGRESS || theErr == EAGAIN) && m_rtspClient->IsAwaitingResponse())
 			{
-				theErr = m_rtspClient->SendPlay(0);
+				m_rtspClient->AbandonTransaction();
 				theErr = ET_NoErr;
-				printf("after send play, theErr = %d.\n", theErr);
-				if (theErr == ET_NoErr)
-				{
-					if (m_rtspClient->GetStatus() != 200)
-					{
-						theErr = ENOTCONN;
-						break;
-					}
-					else
-					{
-						m_state = kPushing;
-						m_pusherState = PUSHER_STATE_CONNECTED;
-						if (m_callbackFunc != NULL) 
-						m_callbackFunc(m_pusherState, 0, m_cbParam);
-					}
-				}
-				endLoop = true;
-				printf("after get send play response, theErr = %d, m_state = %d.\n", theErr, m_state);
+			}
+			else if (theErr != ET_NoErr)
+			{
 				break;
 			}
+			else if (m_rtspClient->GetStatus() != 200)
+			{
+				theErr = ENOTCONN;
+				break;
+			}
+
+			// only a loop reaps the completions, and only the queue's
+			// memory stays put long enough to be sent from in place
+			if (m_zeroCopy && m_loop != NULL && m_rtpSocket == NULL)
+				m_socket->GetSocket()->SetZeroCopy(true);
+
+			pthread_mutex_lock(&m_sendLock);
+			m_rtcp.reset(m_ssrc, m_mediaInfo.audioSamplerate);
+			m_packetizer->reset();
+			pthread_mutex_unlock(&m_sendLock);
+			m_stats.onConnected();
+
+			m_state = kPushing;
+			m_retries = 0;
+			m_pusherState = PUSHER_STATE_CONNECTED;
+			notify(m_pusherState, 0);
+			printf("after get send play response, theErr = %d, m_state = %d.\n", theErr, m_state);
+			break;
 		}
+	}
+
+	return theErr;
+}
+
+int64_t PusherHandler::handshakeFailed(int err, bool retry)
+{
+	cancelRequestTimer();
+	releaseConnectSlot();
+
+    int status = m_rtspClient->GetStatus();
+    if (status == 200 || status == 0) status = (err > 0) ? err : errno;
+	//close socket
+	closeConnection();
+
+	// CONNECT_FAILED while there are retries left, ERROR once it gives up
+	int64_t retryDelay = retry ? nextRetryDelay() : -1;
+	m_state = (retryDelay < 0) ? kDone : kWaitingReconnect;
+    m_pusherState = (retryDelay < 0) ? PUSHER_STATE_ERROR : PUSHER_STATE_CONNECT_FAILED;
+	notify(m_pusherState, status);
+
+	return retryDelay;
+}
+
+void PusherHandler::startHandshake()
+{
+	m_pusherState = PUSHER_STATE_CONNECTING;
+	notify(m_pusherState, 0);
+
+	armRequestTimer();
+	continueHandshake();
+}
+
+void PusherHandler::continueHandshake()
+{
+	for (;;)
+	{
+		uint32_t prevState = m_state;
+		ET_Error theErr = handshakeStep();
 
 		if ((theErr == EINPROGRESS) || (theErr == EAGAIN))
-    	{
+		{
+			// wait for the socket; the request's deadline keeps running
 			uint32_t em = m_socket->GetEventMask();
-			theErr = m_socket->GetSocket()->RequestEvent(em);
-			if (theErr != ET_NoErr) break;
-    	}
-	}
+			int conditionSet = 0;
+			if (em & EV_RE) conditionSet |= SOCKET_READABLE;
+			if (em & EV_WR) conditionSet |= SOCKET_WRITABLE;
+			m_loop->scheduler().setBackgroundHandling(m_socket->GetSocket()->GetSocketFD(), 
+					conditionSet|SOCKET_EXCEPTION, 
+					(TaskScheduler::BackgroundHandlerProc*) &handshakeHandler, this);
+			return;
+		}
 
-    if (m_state != kPushing)
-	{
-        m_pusherState = PUSHER_STATE_ERROR;
-		//close socket
-        delete m_socket; m_socket = NULL;
-		if (m_callbackFunc != NULL)
+		if (theErr != ET_NoErr)
+		{
+			int64_t retryDelay = handshakeFailed(theErr);
+			if (retryDelay >= 0) scheduleConnect(retryDelay);
+			return;
+		}
+
+		if (m_state == kPushing)
 		{
-            int status = m_rtspClient->GetStatus();
-            if (status == 200) status = errno;
-			m_callbackFunc(m_pusherState, status, m_cbParam);
+			cancelRequestTimer();
+			releaseConnectSlot();
+			setSocketHandling(true);
+			scheduleReport(true);
+			return;
 		}
-		return -1;
+
+		// on to the next request, with a deadline of its own
+		if (m_state != prevState)
+			armRequestTimer();
 	}
-	
-    return 0;
+}
+
+void PusherHandler::handshakeHandler(void* clientData, int /*mask*/)
+{
+	((PusherHandler*) clientData)->continueHandshake();
+}
+
+void PusherHandler::armRequestTimer()
+{
+	TaskScheduler& scheduler = m_loop->scheduler();
+	scheduler.unscheduleDelayedTask(m_requestTimer);
+	m_requestTimer = scheduler.scheduleDelayedTask(RTSP_REQUEST_TIMEOUT_MS * 1000, requestTimeout, this);
+}
+
+void PusherHandler::cancelRequestTimer()
+{
+	if (m_loop != NULL)
+		m_loop->scheduler().unscheduleDelayedTask(m_requestTimer);
+}
+
+void PusherHandler::requestTimeout(void* clientData)
+{
+	PusherHandler* hdr = (PusherHandler*) clientData;
+	hdr->m_requestTimer = NULL;
+	int64_t retryDelay = hdr->handshakeFailed(ET_NETTIMEOUT);
+	if (retryDelay >= 0) hdr->scheduleConnect(retryDelay);
 }
 
 int PusherHandler::parseDetailRTSPURL(char const* url, char* &username, char* &password,\
@@ -448,11 +1924,17 @@ int PusherHandler::generateSDPString(const char* addr, const MediaInfo& mi)
 	{
 		m_sdp = new char[1024];
 		char encodingName[16] = {0};
+		bool sampled = false;	// cut by ptime
 
 		switch(mi.audioCodec)
 		{
 			case AUDIO_CODEC_G711:
 				strcpy(encodingName, "PCMU");
+				sampled = true;
+				break;
+			case AUDIO_CODEC_G711A:
+				strcpy(encodingName, "PCMA");
+				sampled = true;
 				break;
 			case AUDIO_CODEC_MP3:
 				strcpy(encodingName, "MPA");
@@ -460,6 +1942,7 @@ int PusherHandler::generateSDPString(const char* addr, const MediaInfo& mi)
 			case AUDIO_CODEC_IMAADPCM_8K:
 			case AUDIO_CODEC_IMAADPCM_16K:
 				strcpy(encodingName, "DVI4");
+				sampled = true;
 				break;
 		}
 
@@ -479,6 +1962,9 @@ int PusherHandler::generateSDPString(const char* addr, const MediaInfo& mi)
 			"a=rtpmap:%d %s/%d/%d\r\n",
 			addr, mi.audioCodec, mi.audioCodec, encodingName,\
 			mi.audioSamplerate, mi.audioChannel);		
+
+		if (sampled && m_ptimeMs > 0)
+			sprintf(m_sdp + strlen(m_sdp), "a=ptime:%u\r\n", m_ptimeMs);
 	}	
 	
 	return 0;
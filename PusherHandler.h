@@ -16,22 +16,81 @@
 
 #include "RTSPClient.h"
 #include "MsgQueue.h"
+#include "PacketQueue.h"
+#include "FrameRing.h"
+#include "RTCPSession.h"
+#include "SessionStats.h"
+#include "CallbackNotifier.h"
+#include "RTPPacketizer.h"
+#include "ImaAdpcmEncoder.h"
+#include "Resampler.h"
+#include "UsageEnvironment.hh"
 
 class ClientSocket;
+class UDPSocket;
+class IoUringSender;
+class PusherEngine;
+class PusherLoop;
 
 class PusherHandler
 {
 	public:
-		static PusherHandler* createNew();
+		static PusherHandler* createNew(PusherEngine* engine = NULL);
 		
 		int setCallbackFunc(PusherCallback cb, void* cbParam);
 		
 		int startStream(const char* url, RTP_ConnectType connType, const char* username, const char* password, \
 			int reconn, const MediaInfo& mi);
+		// Returns at once; the handshake runs on an event loop (the handler's
+		// engine, or the library's shared one) and reports through the callback.
+		int startStreamAsync(const char* url, RTP_ConnectType connType, const char* username, const char* password, \
+			int reconn, const MediaInfo& mi);
 		int closeStream();
 
 		int pushFrame(MediaFrame* frame);
+		// 16 bit linear PCM, encoded for the stream's codec (G.711, or DVI4
+		// in mono) and pushed as a frame. PCM at another rate than the
+		// codec's clock is resampled first.
+		int pushPCM(MediaFrame* frame);
+		// pushPCM() for many streams at once: the DVI4 ones are encoded side
+		// by side, a SIMD lane each. A handler may be in a batch only once.
+		// Returns how many failed, with each result in "results" if given.
+		static int pushPCMBatch(PusherHandler* const* handlers, MediaFrame* const* frames, int count, int* results);
+
+		// Async push: pushFrame() only copies the frame into a lock-free ring
+		// and the loop thread (the engine's, or the library's shared one)
+		// packetizes and sends it. Set before the stream is started.
+		int setAsyncPush(bool enable, uint32_t ringBytes);
+		// PUSHING (and CONGESTED) callbacks summed up over "progressIntervalMs"
+		// instead of one per frame, 0: one per frame. With "notifierThread"
+		// every callback is made from the CallbackNotifier thread instead of
+		// the pushing or loop thread. Set before the stream is started.
+		int setCallbackPolicy(uint32_t progressIntervalMs, bool notifierThread);
+
+		// No RTP packet bigger than "mtu" takes. MP3 (RFC 2250): with
+		// "ptimeMs", small frames are packed into one packet until it is
+		// full or holds that much audio. G.711 and DVI4: the samples are cut
+		// into packets of "ptimeMs", advertised in the SDP; 0: a packet per
+		// frame. Set before the stream is started for the SDP to have it.
+		int setPacketization(uint32_t mtu, uint32_t ptimeMs);
+		int setSendQueueLimits(uint32_t maxPackets, uint32_t maxBytes);
+		// Packets that waited longer than this are dropped, oldest first, and
+		// reported as PUSHER_STATE_CONGESTED. 0 (the default): no budget.
+		int setLatencyBudget(uint32_t maxLatencyMs);
+		int getSendQueueStatus(uint32_t* packets, uint32_t* bytes, uint32_t* dropped);
+		// RTP over UDP: hand equal-size packets to the kernel as one UDP GSO
+		// buffer. Falls back to a datagram each where GSO isn't available.
+		int setUDPSegmentation(bool enable);
+		// RTP over TCP on an engine: queued batches of kZeroCopyMinBytes and
+		// more go out with MSG_ZEROCOPY. Takes effect from the next connect.
+		int setZeroCopy(bool enable);
+		// RTCP of the current connection; engines only
+		int getRTCPStats(RTCPStats* stats);
+		// lock-free, from any thread
+		int getStats(PusherStats* stats);
 		
+		// Once it returns the callback is never called again: off the loop
+		// thread it waits for the loop to run what was queued before.
 		int release(); 
 
 	protected:
@@ -43,7 +102,8 @@ class PusherHandler
 			kSendingPlay		= 3,
 			kPushing			= 4,
 			kSendingTeardown	= 5,
-			kDone				= 6
+			kDone				= 6,
+			kWaitingReconnect	= 7		// backing off, or waiting for a connect slot
 		};
 		
 		PusherHandler();
@@ -52,6 +112,129 @@ class PusherHandler
 		virtual ET_Error SetupStream();
 	
 	private:
+		friend class PusherLoop;
+
+		// Run on the owning PusherLoop thread when bound to an engine.
+		void onStart();
+		void onClose();
+		void onDisconnect();
+		void onRelease();
+		void onWantWrite();
+		void onFlush();
+
+		// io_uring backend: at most one write in flight per handler
+		ET_Error submitQueue(IoUringSender* ring);
+		static void writeDoneHandler(void* clientData, int result);
+		void onWriteDone(int result);
+		void detachWrite();
+
+		static void frameRingHandler(void* clientData, int mask);
+		void drainFrames();
+
+		static void socketHandler(void* clientData, int mask);
+		void socketHandler(int mask);
+		void setSocketHandling(bool enable);
+		// Packetizes and sends (or queues) one frame, on the caller's thread
+		// or, with async push, on the loop thread. "enqueuedUs" is when the
+		// frame was handed over (monotonicUs()), 0: now.
+		int sendFrame(MediaFrame* frame, int64_t enqueuedUs = 0);
+
+		// pushPCM() steps, with m_pcmLock held
+		bool encodesADPCM() const;
+		int reservePCMBuffer(uint32_t bytes);
+		// where the input's rate isn't the codec's, resamples "*frame" into
+		// "resampled" and points "*frame" at it
+		int resamplePCM(MediaFrame** frame, MediaFrame* resampled);
+		// DVI4: writes the header and the sample carried over, and tells the
+		// samples left to encode in pairs and where to
+		int beginADPCM(MediaFrame* frame, const int16_t** pcm, uint8_t** out, uint32_t* samples);
+		// pushes the m_pcmLen bytes of m_pcmBuf in place of "frame"
+		int pushEncoded(MediaFrame* frame);
+		int bindSharedEngine();
+
+		// Queues behind what is waiting, as of "when", making room by the
+		// latency budget. Call with m_sendLock held.
+		int queuePacket(const struct iovec* iov, int iovcnt, int64_t when, int64_t now, uint32_t& dropped);
+		// One RTP packet: writes it, or queues it (as of pkt.when). Call
+		// with m_sendLock held.
+		int sendPacket(const RTPPacketizer::Packet& pkt, int64_t now, uint32_t& dropped, bool& needFlush);
+		bool handleWritable();
+		void handleReadable();
+		// frees what the kernel is done with of the MSG_ZEROCOPY sends
+		void reapZeroCopy();
+		void connectionAborted(int err);
+
+		// A state transition: reported right away, after any progress
+		// summed up so far.
+		void notify(RTSP_Pusher_State state, int code);
+		// Progress from sendFrame(): "count" frames sent (PUSHING) or packets
+		// dropped (CONGESTED), reported by the callback policy.
+		void notifyProgress(RTSP_Pusher_State state, uint32_t count, int64_t now);
+		void flushProgress();
+		// "mustDeliver": wait for room on the notifier queue rather than drop
+		void deliver(RTSP_Pusher_State state, int code, bool mustDeliver);
+		// what the server sends on the RTSP connection while we push:
+		// interleaved RTCP, and RTSP messages (a late PLAY answer) to skip
+		void parseInterleaved(const char* data, uint32_t len);
+
+		// RTCP, on the loop thread: a sender report every few seconds, and
+		// the server's receiver reports (over UDP on the RTCP port)
+		void scheduleReport(bool first);
+		void cancelReport();
+		static void reportHandler(void* clientData);
+		void sendReport();
+		static void rtcpSocketHandler(void* clientData, int mask);
+		void readRTCPSocket();
+
+		void createConnection();
+		void closeConnection();
+
+		// RTP over UDP: binds an even RTP port and the RTCP port above it
+		ET_Error openUDPPorts();
+		void closeUDPPorts();
+		// Writes one packet, or the queue, on whichever transport is in use.
+		// Call with m_sendLock held.
+		ET_Error writePacket(const struct iovec* iov, int iovcnt, uint32_t* sent);
+		ET_Error flushQueue();
+
+		// (Re)connecting on the loop thread: takes a connect slot of the
+		// engine, then runs the handshake.
+		void connect();
+		static void reconnectHandler(void* clientData);
+		void scheduleConnect(int64_t delayUs);
+		void releaseConnectSlot();
+		// Delay before the next retry, or -1 once m_reconn retries are used up.
+		int64_t nextRetryDelay();
+
+		int prepareStream(const char* url, RTP_ConnectType connType, const char* username, const char* password, \
+			int reconn, const MediaInfo& mi);
+
+		// One RTSP request of the handshake. ET_NoErr once it got its answer
+		// (m_state has moved on), EAGAIN/EINPROGRESS while it's under way.
+		ET_Error handshakeStep();
+		// Returns the delay before the next attempt, -1 if there is none
+		// ("retry" false: the caller gives up after this one).
+		int64_t handshakeFailed(int err, bool retry = true);
+
+		// the event driven handshake, on the loop thread
+		void startHandshake();
+		void continueHandshake();
+		static void handshakeHandler(void* clientData, int mask);
+		void armRequestTimer();
+		void cancelRequestTimer();
+		static void requestTimeout(void* clientData);
+
+		int teardown();
+		void destroy();
+
+		// what release() waits on until onRelease() has run
+		struct ReleaseWait
+		{
+			pthread_mutex_t lock;
+			pthread_cond_t cond;
+			bool done;
+		};
+
 		int parseDetailRTSPURL(char const* url, char* &username, char* &password, \
 				char* address,int* portNum);
 		
@@ -60,12 +243,33 @@ class PusherHandler
 	private:
 		PusherCallback m_callbackFunc;
 		void* m_cbParam;
+		CallbackNotifier* m_notifier;	// NULL: callbacks on the calling thread
+		int64_t m_progressIntervalUs;	// 0: a callback per frame
+		// progress not reported yet, and when it last was; relaxed atomics
+		uint32_t m_progressFrames;
+		uint32_t m_progressDropped;
+		int64_t m_lastProgressUs;
 
-		pthread_t m_tid;
+		PusherEngine* m_engine;
+		PusherLoop* m_loop;
 		MyDarwin::RTSPClient* m_rtspClient;
 		ClientSocket* m_socket;
 		RTP_ConnectType m_connType;
-		int m_reconn;
+		UDPSocket* m_rtpSocket;		// RTP over UDP only
+		UDPSocket* m_rtcpSocket;
+		bool m_udpSegmentation;
+		bool m_zeroCopy;
+		int m_reconn;		// retries after a failed or dropped connection, 0: no limit
+		int m_retries;		// since the last successful connect
+		bool m_closing;
+		unsigned m_randSeed;
+
+		// kept to connect again
+		std::string m_url;
+		std::string m_username;
+		std::string m_password;
+		uint32_t m_serverAddr;
+		uint16_t m_serverPort;
 		char* m_sdp;
 
 		uint32_t m_state;
@@ -75,6 +279,52 @@ class PusherHandler
 		uint32_t m_timestampBase;
 		MediaInfo m_mediaInfo;
 
+		// RTP packets the socket hasn't taken yet. pushFrame() appends on the
+		// caller's thread, the loop drains it when the socket turns writable.
+		PacketQueue m_sendQueue;
+		pthread_mutex_t m_sendLock;
+		bool m_writePending;
+		int m_sendError;	// pushFrame() failed, the loop hasn't handled it yet
+		bool m_flushQueued;	// on the loop's flush list (send batching)
+		int m_ioSlot;		// the io_uring buffer in flight, -1: none
+		bool m_teardownPending;	// closed while a write was in flight
+		int64_t m_maxLatencyUs;
+		uint32_t m_droppedPackets;
+		SessionStats m_stats;	// relaxed atomics, read without the lock
+		RTPPacketizer* m_packetizer;	// under m_sendLock, by codec on prepareStream()
+		uint32_t m_mtu;
+		uint32_t m_ptimeMs;
+
+		// what pushPCM() encodes into, grown to the largest frame
+		pthread_mutex_t m_pcmLock;
+		uint8_t* m_pcmBuf;
+		uint32_t m_pcmBufSize;
+		uint32_t m_pcmLen;		// of the frame encoded last
+		bool m_pcmLeading;		// it starts with the sample carried over
+		// DVI4: the encoder, and an odd sample out waiting for the next frame
+		ImaAdpcmEncoder::State m_adpcmState;
+		int16_t m_pcmCarry;
+		bool m_pcmCarried;
+		// the rate pushPCM() is given, and the converter to the codec's,
+		// made on prepareStream() where they differ
+		uint32_t m_pcmRate;
+		Resampler* m_resampler;
+		int16_t* m_rsBuf;
+		uint32_t m_rsBufSize;	// samples
+
+		// deadline of the handshake request in flight
+		TaskToken m_requestTimer;
+		TaskToken m_reconnectTimer;
+
+		RTCPSession m_rtcp;		// under m_sendLock
+		TaskToken m_rtcpTimer;
+		std::string m_rxBuf;	// interleaved input not parsed yet
+
+		// frames handed over by pushFrame() (async push), drained on the loop
+		FrameRing* m_frameRing;
+		bool m_holdsConnectSlot;
+		ReleaseWait* m_releaseWait;	// set by release() before it posts kCmdRelease
+
 };
 
 #endif
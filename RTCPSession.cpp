@@ -0,0 +1,184 @@
+/**
+ * @file RTCPSession.cpp
+ * @brief  推送会话的 RTCP 实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-31
+ */
+#include "common.h"
+#include "RTCPSession.h"
+#include "RTPPacket.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+// seconds from 1900 (NTP) to 1970 (Unix)
+#define NTP_UNIX_OFFSET 2208988800U
+#define RTCP_CNAME_PREFIX "rtsp_pusher-"
+
+static void put16(char* p, uint16_t v)
+{
+	p[0] = (char)(v >> 8);
+	p[1] = (char)v;
+}
+
+static void put32(char* p, uint32_t v)
+{
+	p[0] = (char)(v >> 24);
+	p[1] = (char)(v >> 16);
+	p[2] = (char)(v >> 8);
+	p[3] = (char)v;
+}
+
+static uint32_t get32(const char* p)
+{
+	const unsigned char* u = (const unsigned char*)p;
+	return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+RTCPSession::RTCPSession()
+{
+	reset(0, 0);
+}
+
+void RTCPSession::reset(uint32_t ssrc, uint32_t clockRate)
+{
+	m_ssrc = ssrc;
+	m_clockRate = clockRate;
+	m_packetsSent = 0;
+	m_octetsSent = 0;
+	m_lastRtpTimestamp = 0;
+	m_lastSentUs = 0;
+	m_reportsReceived = 0;
+	m_rttMs = 0;
+	m_jitter = 0;
+	m_fractionLost = 0;
+	m_cumulativeLost = 0;
+	m_highestSeq = 0;
+}
+
+void RTCPSession::ntpNow(uint32_t* ntpSec, uint32_t* ntpFrac)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	*ntpSec = (uint32_t)tv.tv_sec + NTP_UNIX_OFFSET;
+	*ntpFrac = (uint32_t)(((uint64_t)tv.tv_usec << 32) / 1000000);
+}
+
+uint32_t RTCPSession::buildSenderReport(char* buf, uint32_t size)
+{
+	if (m_packetsSent == 0 || size < kMaxPacketSize)
+		return 0;
+
+	// the RTP timestamp that goes with "now": the last packet's, moved on
+	// by the time since it was sent
+	uint32_t ntpSec, ntpFrac;
+	ntpNow(&ntpSec, &ntpFrac);
+	int64_t sinceUs = monotonicUs() - m_lastSentUs;
+	if (sinceUs < 0) sinceUs = 0;
+	uint32_t rtpNow = m_lastRtpTimestamp + (uint32_t)(sinceUs * m_clockRate / 1000000);
+
+	// SR, no report blocks: we don't receive RTP
+	char* p = buf;
+	p[0] = (char)0x80;
+	p[1] = (char)RTPPacket::RTCP_SR;
+	put16(p + 2, 6);				// length in words, less one
+	put32(p + 4, m_ssrc);
+	put32(p + 8, ntpSec);
+	put32(p + 12, ntpFrac);
+	put32(p + 16, rtpNow);
+	put32(p + 20, m_packetsSent);
+	put32(p + 24, m_octetsSent);
+	p += 28;
+
+	// SDES with a CNAME item, padded with nulls to a word boundary
+	char cname[32];
+	int cnameLen = snprintf(cname, sizeof(cname), RTCP_CNAME_PREFIX "%08x", m_ssrc);
+	uint32_t chunkLen = 4 + 2 + cnameLen + 1;	// SSRC, item header, text, end of list
+	chunkLen = (chunkLen + 3) & ~3U;
+
+	p[0] = (char)0x81;
+	p[1] = (char)RTPPacket::RTCP_SDES;
+	put16(p + 2, (uint16_t)(chunkLen / 4));
+	put32(p + 4, m_ssrc);
+	p[8] = 1;							// CNAME
+	p[9] = (char)cnameLen;
+	::memcpy(p + 10, cname, cnameLen);
+	::memset(p + 10 + cnameLen, 0, chunkLen - 6 - cnameLen);
+	p += 4 + chunkLen;
+
+	return (uint32_t)(p - buf);
+}
+
+bool RTCPSession::parse(const char* data, uint32_t len)
+{
+	uint32_t ntpSec, ntpFrac;
+	ntpNow(&ntpSec, &ntpFrac);
+	uint32_t arrival = ntpMiddle(ntpSec, ntpFrac);
+
+	while (len >= 4)
+	{
+		const unsigned char* h = (const unsigned char*)data;
+		if ((h[0] >> 6) != RTPPacket::RTP_VERSION)
+			return false;
+		uint32_t count = h[0] & 0x1F;
+		uint32_t pt = h[1];
+		uint32_t pktLen = ((uint32_t)((h[2] << 8) | h[3]) + 1) * 4;
+		if (pktLen > len)
+			return false;
+
+		// report blocks follow the sender's SSRC, and the sender info of an SR
+		uint32_t off = 0;
+		if (pt == RTPPacket::RTCP_RR) off = 8;
+		else if (pt == RTPPacket::RTCP_SR) off = 28;
+
+		for (uint32_t i = 0; (off > 0) && (i < count) && (off + 24 <= pktLen); i++, off += 24)
+		{
+			const char* rb = data + off;
+			if (get32(rb) != m_ssrc)
+				continue;
+
+			uint32_t lost = get32(rb + 4);
+			m_fractionLost = lost >> 24;
+			m_cumulativeLost = (int32_t)(lost << 8) >> 8;	// 24 bit signed
+			m_highestSeq = get32(rb + 8);
+			m_jitter = get32(rb + 12);
+
+			// RTT = arrival - LSR - DLSR, all in 1/65536 s; nothing before
+			// the receiver has seen one of our SRs
+			uint32_t lsr = get32(rb + 16);
+			uint32_t dlsr = get32(rb + 20);
+			if (lsr != 0)
+			{
+				int32_t rtt = (int32_t)(arrival - lsr - dlsr);
+				m_rttMs = (rtt > 0) ? (uint32_t)(((int64_t)rtt * 1000) >> 16) : 0;
+			}
+			m_reportsReceived++;
+		}
+
+		data += pktLen;
+		len -= pktLen;
+	}
+	return true;
+}
+
+int64_t RTCPSession::nextReportDelayUs(unsigned* randSeed, bool first)
+{
+	int64_t intervalUs = (int64_t)kReportIntervalMs * 1000;
+	if (first) intervalUs /= 2;
+	return intervalUs / 2 + (int64_t)(rand_r(randSeed) % 1000) * intervalUs / 1000;
+}
+
+void RTCPSession::getStats(RTCPStats* stats) const
+{
+	stats->packetsSent = m_packetsSent;
+	stats->octetsSent = m_octetsSent;
+	stats->reportsReceived = m_reportsReceived;
+	stats->rttMs = m_rttMs;
+	stats->jitterMs = (m_clockRate > 0) ? (uint32_t)((uint64_t)m_jitter * 1000 / m_clockRate) : 0;
+	stats->fractionLost = m_fractionLost;
+	stats->cumulativeLost = m_cumulativeLost;
+	stats->highestSeq = m_highestSeq;
+}
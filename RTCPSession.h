@@ -0,0 +1,82 @@
+/**
+ * @file RTCPSession.h
+ * @brief  推送会话的 RTCP: 发送者报告(SR)与接收者报告(RR)解析
+ *
+ *	记录已发送的 RTP 包数和负载字节数, 定期生成 SR + SDES(CNAME) 复合包,
+ *	SR 中给出 NTP 时间与 RTP 时间戳的对应关系, 供接收端做音视频同步;
+ *	解析服务器发来的 RR(或 SR)中关于本流的报告块, 得到往返时延、抖动和丢包.
+ *	本类不加锁, 由调用者保证互斥.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-07-31
+ */
+#ifndef RTCP_SESSION_H
+#define RTCP_SESSION_H
+
+#include <stdint.h>
+#include "API_PusherTypes.h"
+
+class RTCPSession
+{
+	public:
+		enum
+		{
+			kReportIntervalMs	= 5000,		// RFC 3550 minimum
+			kMaxPacketSize		= 128		// the SR + SDES we build
+		};
+
+		RTCPSession();
+
+		// A new connection: counts start over. "clockRate" is that of the
+		// RTP timestamps.
+		void reset(uint32_t ssrc, uint32_t clockRate);
+
+		// One RTP packet went out (or was queued) at "nowUs" (monotonic).
+		void onRTPSent(uint32_t rtpTimestamp, uint32_t payloadBytes, int64_t nowUs)
+		{
+			m_packetsSent++;
+			m_octetsSent += payloadBytes;
+			m_lastRtpTimestamp = rtpTimestamp;
+			m_lastSentUs = nowUs;
+		}
+
+		// Builds the compound SR + SDES for now into "buf". Returns its
+		// length, 0 before the first RTP packet.
+		uint32_t buildSenderReport(char* buf, uint32_t size);
+
+		// A compound RTCP packet from the server. Returns false if it is
+		// malformed; true otherwise, whether or not it reported on us.
+		bool parse(const char* data, uint32_t len);
+
+		// The delay before the next report: the interval, randomized by
+		// 0.5 to 1.5 so that sessions don't report in step. Half of that
+		// before the first one.
+		int64_t nextReportDelayUs(unsigned* randSeed, bool first);
+
+		void getStats(RTCPStats* stats) const;
+
+	private:
+		// middle 32 bits of the NTP time of "now" (1/65536 s units)
+		static uint32_t ntpMiddle(uint32_t ntpSec, uint32_t ntpFrac) { return (ntpSec << 16) | (ntpFrac >> 16); }
+		static void ntpNow(uint32_t* ntpSec, uint32_t* ntpFrac);
+
+	private:
+		uint32_t m_ssrc;
+		uint32_t m_clockRate;
+
+		uint32_t m_packetsSent;
+		uint32_t m_octetsSent;
+		uint32_t m_lastRtpTimestamp;
+		int64_t m_lastSentUs;
+
+		// from the last report block about us
+		uint32_t m_reportsReceived;
+		uint32_t m_rttMs;
+		uint32_t m_jitter;			// RTP timestamp units
+		uint32_t m_fractionLost;	// 1/256
+		int32_t m_cumulativeLost;
+		uint32_t m_highestSeq;
+};
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * @file RTPPacketizer.cpp
+ * @brief  按编码选择 RTP 打包方式
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-09
+ */
+#include "RTPPacketizer.h"
+#include "MPAPacketizer.h"
+#include "SamplePacketizer.h"
+#include <new>
+
+RTPPacketizer* RTPPacketizer::createNew(const MediaInfo& mi)
+{
+	switch (mi.audioCodec)
+	{
+		case AUDIO_CODEC_G711:
+		case AUDIO_CODEC_G711A:
+			return new (std::nothrow) SamplePacketizer(mi.audioSamplerate ? mi.audioSamplerate : 8000,
+					mi.audioChannel, false);
+		case AUDIO_CODEC_IMAADPCM_8K:
+			return new (std::nothrow) SamplePacketizer(mi.audioSamplerate ? mi.audioSamplerate : 8000, 1, true);
+		case AUDIO_CODEC_IMAADPCM_16K:
+			return new (std::nothrow) SamplePacketizer(mi.audioSamplerate ? mi.audioSamplerate : 16000, 1, true);
+		default:
+			return new (std::nothrow) MPAPacketizer();
+	}
+}
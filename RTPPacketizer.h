@@ -0,0 +1,77 @@
+/**
+ * @file RTPPacketizer.h
+ * @brief  把推送的帧切分/合并成 RTP 负载
+ *
+ *	每种编码一个实现: MP3 按 RFC 2250 分片与合并(MPAPacketizer), G.711 和 DVI4
+ *	按采样切成固定时长的包(SamplePacketizer). 推送一帧后逐个取出要发的包,
+ *	包的内容尽量直接引用帧数据, 不拷贝. 本类不加锁, 由调用者保证互斥.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-09
+ */
+#ifndef RTP_PACKETIZER_H
+#define RTP_PACKETIZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+#include "API_PusherTypes.h"
+
+class RTPPacketizer
+{
+	public:
+		enum
+		{
+			kRTPHeaderSize		= 12,
+			kIPUDPOverhead		= 28,		// IPv4 + UDP
+			kDefaultMTU			= 1500,
+			kMinMTU				= 576,
+			kMaxMTU				= 65535
+		};
+
+		// One RTP payload in iov[0..iovcnt).
+		struct Packet
+		{
+			struct iovec iov[2];
+			int iovcnt;
+			uint32_t len;
+			uint32_t timestamp;		// RTP timestamp of its first sample
+			int64_t when;			// queueing time of the frame it starts with
+		};
+
+		// The packetizer for "mi.audioCodec", NULL if out of memory.
+		static RTPPacketizer* createNew(const MediaInfo& mi);
+		virtual ~RTPPacketizer() {}
+
+		// "mtu": of the path; an RTP packet is at most the MTU less the IP
+		// and UDP headers. "ptimeUs": how much audio a packet should carry,
+		// see the implementations; 0: as the frames come. Drops what is
+		// pending. Returns -1 if out of memory.
+		virtual int setLimits(uint32_t mtu, uint32_t ptimeUs) = 0;
+
+		// Hands over a frame, at "frameUs" for "durationUs" on the sender's
+		// clock. "data" must stay valid while nextPacket() returns packets.
+		// Returns false if the frame can't be sent this way (too big).
+		virtual bool addFrame(const char* data, uint32_t len, uint32_t timestamp, int64_t frameUs,
+				int64_t durationUs, int64_t when) = 0;
+		// The next packet to send, false if there is none (the rest of the
+		// frame may be held for the next packet). The packet is valid until
+		// the next call.
+		virtual bool nextPacket(Packet& pkt) = 0;
+		// Forgets the rest of the current frame, e.g. the queue is full.
+		virtual void dropFrame() = 0;
+		// Forgets everything pending, e.g. on a new connection.
+		virtual void reset() = 0;
+
+	protected:
+		// the largest RTP packet, header included, on "mtu"
+		static uint32_t maxPacketSize(uint32_t mtu)
+		{
+			if (mtu < kMinMTU) mtu = kMinMTU;
+			if (mtu > kMaxMTU) mtu = kMaxMTU;
+			return mtu - kIPUDPOverhead;
+		}
+};
+
+#endif
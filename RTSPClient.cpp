@@ -37,7 +37,6 @@ namespace MyDarwin
 {
 const char* RTSPClient::sUserAgent = "RTSPPusherNode";
 const char* RTSPClient::sControlID = "trackID";
-RTSPClient::InterleavedParams RTSPClient::sInterleavedParams;
 
 RTSPClient::RTSPClient(ClientSocket* inSocket, bool verbosePrinting, char* inUserAgent)
 :	fSocket(inSocket),
@@ -84,7 +83,7 @@ RTSPClient::RTSPClient(ClientSocket* inSocket, bool verbosePrinting, char* inUse
     fSetupHeaders = new char[2];
     fSetupHeaders[0] = '\0';
     
-    ::memset(&sInterleavedParams, 0, sizeof(sInterleavedParams));
+    ::memset(&fInterleavedParams, 0, sizeof(fInterleavedParams));
         
         if (inUserAgent != NULL)
         {
@@ -393,11 +392,11 @@ ET_Error RTSPClient::SendInterleavedWrite(uint8_t channel, uint16_t len, char*da
     uint16_t interleavedLen =0;   
     uint16_t sendLen = 0;
     
-    if (sInterleavedParams.extraLen > 0)
+    if (fInterleavedParams.extraLen > 0)
     {   *getNext = false; // can't handle new packet now. Send it again
-        ioVEC[0].iov_base   = sInterleavedParams.extraBytes;
-        ioVEC[0].iov_len    = sInterleavedParams.extraLen;
-        sendLen = sInterleavedParams.extraLen;
+        ioVEC[0].iov_base   = fInterleavedParams.extraBytes;
+        ioVEC[0].iov_len    = fInterleavedParams.extraLen;
+        sendLen = fInterleavedParams.extraLen;
     }
     else
     {   *getNext = true; // handle a new packet
@@ -411,7 +410,7 @@ ET_Error RTSPClient::SendInterleavedWrite(uint8_t channel, uint16_t len, char*da
         ioVEC[0].iov_base=&fSendBuffer[0];
         ioVEC[0].iov_len= interleavedLen;
         sendLen = interleavedLen;
-        sInterleavedParams.extraChannel =channel;
+        fInterleavedParams.extraChannel =channel;
     }   
         
     uint32_t outLenSent;
@@ -420,44 +419,44 @@ ET_Error RTSPClient::SendInterleavedWrite(uint8_t channel, uint16_t len, char*da
         outLenSent = 0;
 
     if (theErr == 0 && outLenSent != sendLen) 
-    {   if (sInterleavedParams.extraLen > 0) // sending extra len so keep sending it.
+    {   if (fInterleavedParams.extraLen > 0) // sending extra len so keep sending it.
         {   
-            sInterleavedParams.extraLen = sendLen - outLenSent;
-            sInterleavedParams.extraByteOffset += outLenSent;
-            sInterleavedParams.extraBytes = &fSendBuffer[sInterleavedParams.extraByteOffset];
+            fInterleavedParams.extraLen = sendLen - outLenSent;
+            fInterleavedParams.extraByteOffset += outLenSent;
+            fInterleavedParams.extraBytes = &fSendBuffer[fInterleavedParams.extraByteOffset];
         }
         else // we were sending a new packet so record the data
         {   
-            sInterleavedParams.extraBytes = &fSendBuffer[outLenSent];
-            sInterleavedParams.extraLen = sendLen - outLenSent;
-            sInterleavedParams.extraChannel = channel;
-            sInterleavedParams.extraByteOffset = outLenSent;
+            fInterleavedParams.extraBytes = &fSendBuffer[outLenSent];
+            fInterleavedParams.extraLen = sendLen - outLenSent;
+            fInterleavedParams.extraChannel = channel;
+            fInterleavedParams.extraByteOffset = outLenSent;
         }
     }
     else // either an error occured or we sent everything ok
     {
         if (theErr == 0)
         {   
-            if (sInterleavedParams.extraLen > 0) // we were busy sending some old data and it all got sent
+            if (fInterleavedParams.extraLen > 0) // we were busy sending some old data and it all got sent
             {   
-				//printf("RTSPClient::SendInterleavedWrite FULL Send channel=%u bufferlen=%u err=%d amountSent=%u \n",(uint16_t) sInterleavedParams.extraChannel,sendLen,theErr,outLenSent);
+				//printf("RTSPClient::SendInterleavedWrite FULL Send channel=%u bufferlen=%u err=%d amountSent=%u \n",(uint16_t) fInterleavedParams.extraChannel,sendLen,theErr,outLenSent);
             }
             else 
             {   // it all worked so ask for more data
 				//printf("RTSPClient::SendInterleavedWrite FULL Send channel=%u bufferlen=%u err=%d amountSent=%u \n",(uint16_t) channel,sendLen,theErr,outLenSent);
             }
-            sInterleavedParams.extraLen = 0;
-            sInterleavedParams.extraBytes = NULL;
-            sInterleavedParams.extraByteOffset = 0;
+            fInterleavedParams.extraLen = 0;
+            fInterleavedParams.extraBytes = NULL;
+            fInterleavedParams.extraByteOffset = 0;
         }
         else // we got an error so nothing was sent
         {   
-            if (sInterleavedParams.extraLen == 0) // retry the new packet
+            if (fInterleavedParams.extraLen == 0) // retry the new packet
             {   
-                sInterleavedParams.extraBytes = &fSendBuffer[0];
-                sInterleavedParams.extraLen = sendLen;
-                sInterleavedParams.extraChannel = channel;              
-                sInterleavedParams.extraByteOffset = 0;
+                fInterleavedParams.extraBytes = &fSendBuffer[0];
+                fInterleavedParams.extraLen = sendLen;
+                fInterleavedParams.extraChannel = channel;              
+                fInterleavedParams.extraByteOffset = 0;
             }       
         }
     }   
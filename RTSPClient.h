@@ -83,6 +83,11 @@ class RTSPClient
         char*       GetResponse()           { return fRecvHeaderBuffer; }
         uint32_t      GetResponseLen()        { return fHeaderLen; }
         bool      IsTransactionInProgress() { return fState != kInitial; }
+        // The request has been written out and we are waiting for (the rest of) the response
+        bool      IsAwaitingResponse() { return fState == kResponseReceiving || fState == kHeaderReceived; }
+        // Gives up on the response to the current request, so that a new request can be made.
+        // (Whatever arrives for the abandoned request must be consumed by the caller)
+        void        AbandonTransaction() { fState = kInitial; }
         
         enum { kPlayMode=0,kPushMode=1,kRecordMode=2};
 
@@ -217,7 +222,7 @@ static  const char*       sControlID;
             uint8_t   extraChannel;
             int     extraByteOffset;
         };
-        static InterleavedParams sInterleavedParams;
+        InterleavedParams fInterleavedParams; // per connection: a partial write belongs to this socket only
         
 };
 }//namespace
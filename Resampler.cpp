@@ -0,0 +1,406 @@
+/**
+ * @file Resampler.cpp
+ * @brief  多相重采样实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-15
+ */
+#include "Resampler.h"
+#include "CpuFeatures.h"
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <new>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLER_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+enum
+{
+	kHalfWidth		= 24,		// the filter's half length, in periods of the lower rate
+	kCoefBits		= 14,		// the taps' fraction bits
+	kTapsAlign		= 16,		// a phase's taps round up to this, for the SIMD loops
+	kMaxRatio		= 32		// the most the input rate may be over the output's
+};
+
+static const double kRolloff = 0.9;	// the cutoff, of half the lower rate
+static const double kBeta = 8.0;		// the Kaiser window's
+
+struct Resampler::Bank
+{
+	uint32_t inRate;
+	uint32_t outRate;
+	uint32_t phases;		// L: outputs come at a phase in L of an input period
+	uint32_t stepInt;		// M / L: input periods from an output to the next
+	uint32_t stepFrac;		// M % L
+	uint32_t taps;			// per phase, a multiple of kTapsAlign
+	int16_t* coefs;			// phases x taps, Q14, oldest input's first; each phase sums to 1
+	Bank* next;
+};
+
+typedef size_t (*FilterProc)(const Resampler::Bank* bank, const int16_t* x, size_t len, size_t* next,
+		uint32_t* phase, int16_t* out, size_t stride);
+
+static inline int16_t descale(int32_t sum)
+{
+	sum = (sum + (1 << (kCoefBits - 1))) >> kCoefBits;
+	if (sum > 32767) return 32767;
+	if (sum < -32768) return -32768;
+	return (int16_t) sum;
+}
+
+static inline void advance(const Resampler::Bank* bank, size_t* next, uint32_t* phase)
+{
+	*next += bank->stepInt;
+	*phase += bank->stepFrac;
+	if (*phase >= bank->phases)
+	{
+		*phase -= bank->phases;
+		(*next)++;
+	}
+}
+
+// The outputs whose newest input is in "x", up to "len", from *next on.
+// The sums can't overflow: no phase's taps add up to 4 in magnitude.
+
+static size_t filterScalar(const Resampler::Bank* bank, const int16_t* x, size_t len, size_t* next,
+		uint32_t* phase, int16_t* out, size_t stride)
+{
+	size_t n = 0;
+	while (*next < len)
+	{
+		const int16_t* h = bank->coefs + (size_t) *phase * bank->taps;
+		const int16_t* w = x + *next + 1 - bank->taps;
+		int32_t sum = 0;
+		for (size_t j = 0; j < bank->taps; j++)
+			sum += h[j] * w[j];
+		out[n++ * stride] = descale(sum);
+		advance(bank, next, phase);
+	}
+	return n;
+}
+
+#ifdef RESAMPLER_X86_KERNELS
+
+// pmaddwd: pairs of 16 bit products summed to 32 bits, then the lanes added up.
+
+__attribute__((target("sse2")))
+static size_t filterSSE2(const Resampler::Bank* bank, const int16_t* x, size_t len, size_t* next,
+		uint32_t* phase, int16_t* out, size_t stride)
+{
+	size_t n = 0;
+	while (*next < len)
+	{
+		const int16_t* h = bank->coefs + (size_t) *phase * bank->taps;
+		const int16_t* w = x + *next + 1 - bank->taps;
+		__m128i acc0 = _mm_setzero_si128();
+		__m128i acc1 = _mm_setzero_si128();
+		for (size_t j = 0; j < bank->taps; j += 16)
+		{
+			acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (h + j)),
+					_mm_loadu_si128((const __m128i*) (w + j))));
+			acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (h + j + 8)),
+					_mm_loadu_si128((const __m128i*) (w + j + 8))));
+		}
+		__m128i s = _mm_add_epi32(acc0, acc1);
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+		out[n++ * stride] = descale(_mm_cvtsi128_si32(s));
+		advance(bank, next, phase);
+	}
+	return n;
+}
+
+__attribute__((target("avx2")))
+static size_t filterAVX2(const Resampler::Bank* bank, const int16_t* x, size_t len, size_t* next,
+		uint32_t* phase, int16_t* out, size_t stride)
+{
+	size_t n = 0;
+	while (*next < len)
+	{
+		const int16_t* h = bank->coefs + (size_t) *phase * bank->taps;
+		const int16_t* w = x + *next + 1 - bank->taps;
+		__m256i acc0 = _mm256_setzero_si256();
+		__m256i acc1 = _mm256_setzero_si256();
+		size_t j = 0;
+		for (; j + 32 <= bank->taps; j += 32)
+		{
+			acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*) (h + j)),
+					_mm256_loadu_si256((const __m256i*) (w + j))));
+			acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*) (h + j + 16)),
+					_mm256_loadu_si256((const __m256i*) (w + j + 16))));
+		}
+		if (j < bank->taps)
+			acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*) (h + j)),
+					_mm256_loadu_si256((const __m256i*) (w + j))));
+		acc0 = _mm256_add_epi32(acc0, acc1);
+		__m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc0), _mm256_extracti128_si256(acc0, 1));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+		out[n++ * stride] = descale(_mm_cvtsi128_si32(s));
+		advance(bank, next, phase);
+	}
+	return n;
+}
+
+#endif
+
+struct Kernels
+{
+	FilterProc filter;
+	const char* name;
+};
+
+static const Kernels& kernels()
+{
+	static const Kernels scalar = { filterScalar, "scalar" };
+#ifdef RESAMPLER_X86_KERNELS
+	static const Kernels sse2 = { filterSSE2, "sse2" };
+	static const Kernels avx2 = { filterAVX2, "avx2" };
+
+	CpuFeatures::Level level = CpuFeatures::level();
+	if (level >= CpuFeatures::kAVX2) return avx2;
+	if (level >= CpuFeatures::kSSE2) return sse2;
+#endif
+	return scalar;
+}
+
+// Filter banks by rates, built when first asked for and kept for good:
+// there are only ever a few.
+
+static pthread_mutex_t s_banksLock = PTHREAD_MUTEX_INITIALIZER;
+static Resampler::Bank* s_banks = NULL;
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b != 0)
+	{
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static double besselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for (int k = 1; k < 64; k++)
+	{
+		double t = x / (2.0 * k);
+		term *= t * t;
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+// A Kaiser windowed sinc at L times the input rate, L * taps long, split
+// into L phases; each phase is scaled to a gain of 1 and rounded to Q14,
+// the rounding error going to its largest tap.
+static Resampler::Bank* buildBank(uint32_t inRate, uint32_t outRate)
+{
+	uint32_t g = gcd(inRate, outRate);
+	uint32_t L = outRate / g;
+	uint32_t M = inRate / g;
+	if (L > Resampler::kMaxPhases || M > (uint32_t) kMaxRatio * L) return NULL;
+
+	uint32_t taps = (2 * kHalfWidth * ((M > L) ? M : L) + L - 1) / L;
+	taps = (taps + kTapsAlign - 1) / kTapsAlign * kTapsAlign;
+
+	int16_t* coefs = new (std::nothrow) int16_t[(size_t) L * taps];
+	double* row = new (std::nothrow) double[taps];
+	Resampler::Bank* bank = new (std::nothrow) Resampler::Bank;
+	if (coefs == NULL || row == NULL || bank == NULL)
+	{
+		delete[] coefs;
+		delete[] row;
+		delete bank;
+		return NULL;
+	}
+
+	double cutoff = kRolloff * 0.5 / ((M > L) ? M : L);	// cycles per sample at L times the input rate
+	double half = (double) L * taps / 2.0;
+	double center = ((double) L * taps - 1.0) / 2.0;
+	double norm = besselI0(kBeta);
+	bool ok = true;
+
+	for (uint32_t p = 0; p < L && ok; p++)
+	{
+		double sum = 0.0;
+		for (uint32_t j = 0; j < taps; j++)
+		{
+			double t = p + (double) j * L - center;
+			double r = t / half;
+			double a = 2.0 * cutoff * t;
+			double v = (a == 0.0) ? 1.0 : sin(M_PI * a) / (M_PI * a);
+			v *= besselI0(kBeta * sqrt(1.0 - r * r)) / norm;
+			row[taps - 1 - j] = v;		// multiplies the input j periods back
+			sum += v;
+		}
+
+		int16_t* h = coefs + (size_t) p * taps;
+		int32_t qsum = 0;
+		uint32_t peak = 0;
+		for (uint32_t j = 0; j < taps; j++)
+		{
+			long q = lrint(row[j] / sum * (1 << kCoefBits));
+			if (q > 32767) q = 32767;
+			if (q < -32767) q = -32767;
+			h[j] = (int16_t) q;
+			qsum += h[j];
+			if (abs(h[j]) > abs(h[peak])) peak = j;
+		}
+		int32_t fixed = h[peak] + ((1 << kCoefBits) - qsum);
+		if (fixed > 32767 || fixed < -32767) ok = false;
+		else h[peak] = (int16_t) fixed;
+
+		int32_t mag = 0;
+		for (uint32_t j = 0; j < taps; j++)
+			mag += abs(h[j]);
+		if (mag >= (4 << kCoefBits)) ok = false;
+	}
+	delete[] row;
+	if (!ok)
+	{
+		delete[] coefs;
+		delete bank;
+		return NULL;
+	}
+
+	bank->inRate = inRate;
+	bank->outRate = outRate;
+	bank->phases = L;
+	bank->stepInt = M / L;
+	bank->stepFrac = M % L;
+	bank->taps = taps;
+	bank->coefs = coefs;
+	bank->next = NULL;
+	return bank;
+}
+
+static const Resampler::Bank* findBank(uint32_t inRate, uint32_t outRate)
+{
+	pthread_mutex_lock(&s_banksLock);
+	Resampler::Bank* bank = s_banks;
+	while (bank != NULL && (bank->inRate != inRate || bank->outRate != outRate))
+		bank = bank->next;
+	if (bank == NULL)
+	{
+		bank = buildBank(inRate, outRate);
+		if (bank != NULL)
+		{
+			bank->next = s_banks;
+			s_banks = bank;
+		}
+	}
+	pthread_mutex_unlock(&s_banksLock);
+	return bank;
+}
+
+Resampler* Resampler::createNew(uint32_t inRate, uint32_t outRate, uint32_t channels)
+{
+	if (inRate == 0 || outRate == 0 || inRate == outRate) return NULL;
+	if (channels == 0) channels = 1;
+
+	const Bank* bank = findBank(inRate, outRate);
+	if (bank == NULL) return NULL;
+
+	int16_t* hist = new (std::nothrow) int16_t[(size_t) channels * (kChunk + bank->taps - 1)];
+	if (hist == NULL) return NULL;
+	Resampler* resampler = new (std::nothrow) Resampler(bank, channels, hist);
+	if (resampler == NULL) delete[] hist;
+	return resampler;
+}
+
+Resampler::Resampler(const Bank* bank, uint32_t channels, int16_t* hist)
+	: m_bank(bank), m_channels(channels), m_hist(hist)
+{
+	reset();
+}
+
+Resampler::~Resampler()
+{
+	delete[] m_hist;
+}
+
+void Resampler::reset()
+{
+	// silence before the first input, a filter's length of it
+	size_t stride = kChunk + m_bank->taps - 1;
+	for (uint32_t c = 0; c < m_channels; c++)
+		::memset(m_hist + c * stride, 0, (m_bank->taps - 1) * sizeof(int16_t));
+	m_histLen = m_bank->taps - 1;
+	m_next = m_bank->taps - 1;
+	m_phase = 0;
+}
+
+size_t Resampler::maxOutput(size_t frames) const
+{
+	uint64_t L = m_bank->phases;
+	uint64_t M = (uint64_t) m_bank->stepInt * L + m_bank->stepFrac;
+	return (size_t) (((uint64_t) frames * L + M - 1) / M + 1);
+}
+
+size_t Resampler::process(const int16_t* in, size_t frames, int16_t* out)
+{
+	FilterProc filter = kernels().filter;
+	size_t stride = kChunk + m_bank->taps - 1;
+	size_t total = 0;
+
+	while (frames > 0)
+	{
+		size_t n = (frames < (size_t) kChunk) ? frames : (size_t) kChunk;
+		for (uint32_t c = 0; c < m_channels; c++)
+		{
+			int16_t* h = m_hist + c * stride + m_histLen;
+			for (size_t i = 0; i < n; i++)
+				h[i] = in[i * m_channels + c];
+		}
+
+		// every channel takes the same steps
+		size_t len = m_histLen + n;
+		size_t next = m_next;
+		uint32_t phase = m_phase;
+		size_t made = 0;
+		for (uint32_t c = 0; c < m_channels; c++)
+		{
+			next = m_next;
+			phase = m_phase;
+			made = filter(m_bank, m_hist + c * stride, len, &next, &phase, out + total * m_channels + c,
+					m_channels);
+		}
+
+		// keep what the next output's filter reaches back to
+		size_t drop = next + 1 - m_bank->taps;
+		for (uint32_t c = 0; c < m_channels; c++)
+			::memmove(m_hist + c * stride, m_hist + c * stride + drop, (len - drop) * sizeof(int16_t));
+		m_histLen = len - drop;
+		m_next = next - drop;
+		m_phase = phase;
+
+		total += made;
+		in += n * m_channels;
+		frames -= n;
+	}
+	return total;
+}
+
+uint32_t Resampler::inRate() const
+{
+	return m_bank->inRate;
+}
+
+uint32_t Resampler::outRate() const
+{
+	return m_bank->outRate;
+}
+
+const char* Resampler::kernelName()
+{
+	return kernels().name;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file Resampler.h
+ * @brief  16 位线性 PCM 的流式多相重采样
+ *
+ *	采样率之比约为 L / M, 先内插 L 倍再抽取 M 倍, 低通滤波器(Kaiser 窗 sinc)拆成 L 相,
+ *	每个输出采样只用其中一相与最近的输入做点积. 滤波器组在第一次用到某对采样率时
+ *	计算一次, 按 Q14 定点存放, 所有同采样率的流共用; 点积用整数乘加, 各 SIMD 实现
+ *	与标量实现的结果逐位相同. 截止频率为较低采样率一半的 90%, 阻带衰减 60dB 以上,
+ *	延时约为半个滤波器长度(48kHz 到 8kHz 为 3ms).
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-15
+ */
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Resampler
+{
+	public:
+		enum
+		{
+			kMaxPhases		= 1024,		// L after the rates' common factor is taken out
+			kChunk			= 1024		// input frames filtered at a time
+		};
+
+		// NULL if the rates are equal, 0 or too far from a small ratio
+		static Resampler* createNew(uint32_t inRate, uint32_t outRate, uint32_t channels);
+		~Resampler();
+
+		// the most frames process() writes for "frames" input frames
+		size_t maxOutput(size_t frames) const;
+		// "frames" interleaved frames in, the frames written to "out" back
+		size_t process(const int16_t* in, size_t frames, int16_t* out);
+		// forgets the input so far, as at the start
+		void reset();
+
+		uint32_t inRate() const;
+		uint32_t outRate() const;
+
+		// the kernels process() runs: "avx2", "sse2" or "scalar"
+		static const char* kernelName();
+
+		struct Bank;
+
+	private:
+		Resampler(const Bank* bank, uint32_t channels, int16_t* hist);
+
+	private:
+		const Bank* m_bank;			// shared, never freed
+		uint32_t m_channels;
+
+		// a channel after another, kChunk + the filter's length - 1 each
+		int16_t* m_hist;
+		size_t m_histLen;			// samples in each channel's history
+		size_t m_next;				// where the next output's newest input is
+		uint32_t m_phase;			// and which of the filter's phases it takes
+};
+
+#endif
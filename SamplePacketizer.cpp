@@ -0,0 +1,188 @@
+/**
+ * @file SamplePacketizer.cpp
+ * @brief  G.711 / DVI4 RTP 打包实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-09
+ */
+#include "SamplePacketizer.h"
+#include <string.h>
+#include <new>
+
+SamplePacketizer::SamplePacketizer(uint32_t sampleRate, uint32_t channels, bool dvi4)
+	: m_sampleRate(sampleRate), m_dvi4(dvi4), m_maxBytes(0), m_packetBytes(0),
+	  m_buf(NULL)
+{
+	m_state.predictor = 0;
+	m_state.index = 0;
+	m_unit = dvi4 ? 1 : ((channels > 0) ? channels : 1);
+	m_unitSamples = dvi4 ? 2 : 1;
+	setLimits(kDefaultMTU, 0);
+}
+
+SamplePacketizer::~SamplePacketizer()
+{
+	delete[] m_buf;
+}
+
+int SamplePacketizer::setLimits(uint32_t mtu, uint32_t ptimeUs)
+{
+	uint32_t maxBytes = maxPacketSize(mtu) - kRTPHeaderSize - headerSize();
+	maxBytes -= maxBytes % m_unit;
+	if (maxBytes != m_maxBytes || m_buf == NULL)
+	{
+		char* buf = new (std::nothrow) char[headerSize() + maxBytes];
+		if (buf == NULL) return -1;
+		delete[] m_buf;
+		m_buf = buf;
+		m_maxBytes = maxBytes;
+	}
+
+	m_packetBytes = 0;
+	if (ptimeUs > 0)
+	{
+		uint64_t samples = (uint64_t) ptimeUs * m_sampleRate / 1000000;
+		uint64_t bytes = samples / m_unitSamples * m_unit;
+		if (bytes == 0) bytes = m_unit;
+		m_packetBytes = (bytes < m_maxBytes) ? (uint32_t) bytes : m_maxBytes;
+	}
+	reset();
+	return 0;
+}
+
+void SamplePacketizer::reset()
+{
+	m_frame = NULL;
+	m_started = false;
+	m_bufLen = 0;
+	m_bufBreak = false;
+	m_bufSent = false;
+}
+
+bool SamplePacketizer::addFrame(const char* data, uint32_t len, uint32_t timestamp, int64_t /*frameUs*/,
+		int64_t /*durationUs*/, int64_t when)
+{
+	if (m_dvi4)
+	{
+		// the encoder's state at the first sample
+		if (len < kDVI4HeaderSize || !ImaAdpcmEncoder::readHeader((const uint8_t*) data, m_state))
+			return false;
+		data += kDVI4HeaderSize;
+		len -= kDVI4HeaderSize;
+	}
+
+	len -= len % m_unit;
+	m_frame = (len > 0) ? data : NULL;
+	m_frameLen = len;
+	m_frameOffset = 0;
+	m_frameWhen = when;
+	if (m_frame == NULL) return true;
+
+	// the caller's timestamps are rounded from microseconds: within a
+	// millisecond of where the last frame ended, the audio runs on
+	int32_t gap = (int32_t) (timestamp - m_timestamp);
+	if (gap < 0) gap = -gap;
+	if (!m_started || (uint32_t) gap > m_sampleRate / 1000)
+	{
+		if (m_bufLen > 0 && !m_bufSent)
+			m_bufBreak = true;
+		m_timestamp = timestamp;
+	}
+	m_started = true;
+	return true;
+}
+
+bool SamplePacketizer::nextPacket(Packet& pkt)
+{
+	if (m_bufSent)
+	{
+		m_bufLen = 0;
+		m_bufSent = false;
+	}
+	if (m_bufLen > 0 && m_bufBreak)
+		return emitBuffer(pkt);
+	if (m_frame == NULL) return false;
+
+	uint32_t left = m_frameLen - m_frameOffset;
+	if (m_packetBytes == 0)
+		return emitDirect(pkt, (left < m_maxBytes) ? left : m_maxBytes);
+	if (m_bufLen == 0 && left >= m_packetBytes)
+		return emitDirect(pkt, m_packetBytes);
+
+	// the packet spans frames: gather it
+	if (m_bufLen == 0)
+	{
+		writeHeader(m_buf);
+		m_bufTimestamp = m_timestamp;
+		m_bufWhen = m_frameWhen;
+	}
+	uint32_t n = m_packetBytes - m_bufLen;
+	if (n > left) n = left;
+	::memcpy(m_buf + headerSize() + m_bufLen, m_frame + m_frameOffset, n);
+	m_bufLen += n;
+	take(n);
+
+	if (m_bufLen == m_packetBytes)
+		return emitBuffer(pkt);
+	return false;
+}
+
+void SamplePacketizer::dropFrame()
+{
+	// what is gathered would no longer run on into the next frame
+	if (!m_bufSent)
+		m_bufLen = 0;
+	if (m_frame != NULL)
+		take(m_frameLen - m_frameOffset);
+}
+
+void SamplePacketizer::writeHeader(char* hdr) const
+{
+	if (m_dvi4)
+		ImaAdpcmEncoder::writeHeader(m_state, (uint8_t*) hdr);
+}
+
+void SamplePacketizer::take(uint32_t n)
+{
+	if (m_dvi4)
+		ImaAdpcmEncoder::advance(m_state, (const uint8_t*) (m_frame + m_frameOffset), n);
+
+	m_frameOffset += n;
+	m_timestamp += n / m_unit * m_unitSamples;
+	if (m_frameOffset == m_frameLen)
+		m_frame = NULL;
+}
+
+bool SamplePacketizer::emitDirect(Packet& pkt, uint32_t n)
+{
+	int i = 0;
+	if (m_dvi4)
+	{
+		writeHeader(m_header);
+		pkt.iov[i].iov_base = m_header;
+		pkt.iov[i].iov_len = kDVI4HeaderSize;
+		i++;
+	}
+	pkt.iov[i].iov_base = (void*) (m_frame + m_frameOffset);
+	pkt.iov[i].iov_len = n;
+	pkt.iovcnt = i + 1;
+	pkt.len = headerSize() + n;
+	pkt.timestamp = m_timestamp;
+	pkt.when = m_frameWhen;
+
+	take(n);
+	return true;
+}
+
+bool SamplePacketizer::emitBuffer(Packet& pkt)
+{
+	pkt.iov[0].iov_base = m_buf;
+	pkt.iov[0].iov_len = headerSize() + m_bufLen;
+	pkt.iovcnt = 1;
+	pkt.len = headerSize() + m_bufLen;
+	pkt.timestamp = m_bufTimestamp;
+	pkt.when = m_bufWhen;
+	m_bufBreak = false;
+	m_bufSent = true;
+	return true;
+}
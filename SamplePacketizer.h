@@ -0,0 +1,79 @@
+/**
+ * @file SamplePacketizer.h
+ * @brief  按采样打包的音频(G.711 PCMU/PCMA, DVI4)的 RTP 打包, RFC 3551
+ *
+ *	推送的帧可以是任意长度的采样数据, 按设定的包时长(ptime)切成等长的包,
+ *	不足一个包的部分留待下一帧补齐; 包时长为 0 时按帧发送, 只在超过包长上限时切分.
+ *	DVI4 的每帧和每个包都以 4 字节头开始(预测值, 步长索引, 保留), 采样按高 4 位在前排列;
+ *	帧头给出帧首的编码状态, 包头由此跟踪 IMA ADPCM 解码状态得出, 所以丢帧不影响后续的包.
+ *	整包落在一帧之内时直接引用帧数据, 跨帧的包拷进内部缓冲.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-09
+ */
+#ifndef SAMPLE_PACKETIZER_H
+#define SAMPLE_PACKETIZER_H
+
+#include "RTPPacketizer.h"
+#include "ImaAdpcmEncoder.h"
+
+class SamplePacketizer : public RTPPacketizer
+{
+	public:
+		enum { kDVI4HeaderSize = ImaAdpcmEncoder::kHeaderSize };
+
+		// "dvi4": frames of a DVI4 header and 4 bit IMA ADPCM samples, mono;
+		// otherwise a byte per sample and channel.
+		SamplePacketizer(uint32_t sampleRate, uint32_t channels, bool dvi4);
+		virtual ~SamplePacketizer();
+
+		// "ptimeUs": the audio of one packet, cut down to what the MTU
+		// takes; 0: a packet per frame.
+		virtual int setLimits(uint32_t mtu, uint32_t ptimeUs);
+
+		// A DVI4 frame without a valid header is refused.
+		virtual bool addFrame(const char* data, uint32_t len, uint32_t timestamp, int64_t frameUs,
+				int64_t durationUs, int64_t when);
+		virtual bool nextPacket(Packet& pkt);
+		virtual void dropFrame();
+		virtual void reset();
+
+	private:
+		uint32_t headerSize() const { return m_dvi4 ? kDVI4HeaderSize : 0; }
+		void writeHeader(char* hdr) const;
+		void take(uint32_t n);
+		bool emitDirect(Packet& pkt, uint32_t n);
+		bool emitBuffer(Packet& pkt);
+
+	private:
+		uint32_t m_sampleRate;
+		bool m_dvi4;
+		uint32_t m_unit;			// bytes of the smallest whole piece of audio
+		uint32_t m_unitSamples;		// samples (per channel) in it
+
+		uint32_t m_maxBytes;		// payload after the header the MTU takes, whole units
+		uint32_t m_packetBytes;		// the same for the ptime, 0: a packet per frame
+
+		// the frame being handed out, from m_frameOffset on
+		const char* m_frame;
+		uint32_t m_frameLen;
+		uint32_t m_frameOffset;
+		uint32_t m_timestamp;		// of the first byte not taken yet
+		int64_t m_frameWhen;
+		bool m_started;				// m_timestamp runs on from an earlier frame
+		char m_header[kDVI4HeaderSize];
+
+		// DVI4 decoder state before the first byte not taken yet
+		ImaAdpcmEncoder::State m_state;
+
+		// a packet gathered across frames, after room for the header
+		char* m_buf;
+		uint32_t m_bufLen;			// 0: nothing gathered
+		uint32_t m_bufTimestamp;
+		int64_t m_bufWhen;
+		bool m_bufBreak;			// the next frame doesn't follow on: send it short
+		bool m_bufSent;				// handed out, to be cleared on the next call
+};
+
+#endif
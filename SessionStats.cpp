@@ -0,0 +1,101 @@
+/**
+ * @file SessionStats.cpp
+ * @brief  推送会话的发送统计实现
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-02
+ */
+#include "SessionStats.h"
+#include <string.h>
+
+void LatencyHistogram::reset()
+{
+	::memset(m_counts, 0, sizeof(m_counts));
+	m_samples = 0;
+	m_sumUs = 0;
+	m_maxUs = 0;
+}
+
+uint32_t LatencyHistogram::bucketHighest(uint32_t idx)
+{
+	if (idx < kSubBuckets) return idx;
+	uint32_t shift = idx / kSubBuckets - 1;
+	uint64_t lowest = (uint64_t)(kSubBuckets + idx % kSubBuckets) << shift;
+	return (uint32_t)(lowest + ((uint64_t)1 << shift) - 1);
+}
+
+void LatencyHistogram::getStats(PusherStats* stats) const
+{
+	// a snapshot of the buckets; records that land meanwhile may or may not
+	// be in it, the total is counted from the copy so the ranks add up
+	uint64_t counts[kNumBuckets];
+	uint64_t total = 0;
+	for (int i = 0; i < kNumBuckets; i++)
+	{
+		counts[i] = __atomic_load_n(&m_counts[i], __ATOMIC_RELAXED);
+		total += counts[i];
+	}
+	uint64_t sum = __atomic_load_n(&m_sumUs, __ATOMIC_RELAXED);
+	uint64_t samples = __atomic_load_n(&m_samples, __ATOMIC_RELAXED);
+	uint32_t max = __atomic_load_n(&m_maxUs, __ATOMIC_RELAXED);
+
+	stats->latencySamples = total;
+	stats->latencyMeanUs = (samples > 0) ? (uint32_t)(sum / samples) : 0;
+	stats->latencyMaxUs = max;
+
+	// per thousand; the value reported is the top of the bucket the rank
+	// falls in, but no more than the largest value seen
+	static const uint32_t kPermille[] = { 500, 900, 990, 999 };
+	unsigned int* out[] = { &stats->latencyP50Us, &stats->latencyP90Us,
+		&stats->latencyP99Us, &stats->latencyP999Us };
+
+	uint64_t seen = 0;
+	int i = 0;
+	for (int q = 0; q < 4; q++)
+	{
+		*out[q] = 0;
+		if (total == 0) continue;
+
+		uint64_t rank = (total * kPermille[q] + 999) / 1000;
+		if (rank == 0) rank = 1;
+		while ((i < kNumBuckets) && (seen + counts[i] < rank))
+			seen += counts[i++];
+		if (i == kNumBuckets) break;
+
+		uint32_t v = bucketHighest(i);
+		*out[q] = (v < max) ? v : max;
+	}
+}
+
+void SessionStats::reset()
+{
+	m_framesSent = 0;
+	m_bytesSent = 0;
+	m_partialWrites = 0;
+	m_droppedLatency = 0;
+	m_droppedQueueFull = 0;
+	m_droppedRingFull = 0;
+	m_droppedNotPushing = 0;
+	m_connects = 0;
+	m_queuePackets = 0;
+	m_queueBytes = 0;
+	m_latency.reset();
+}
+
+void SessionStats::getStats(PusherStats* stats) const
+{
+	stats->framesSent = load(m_framesSent);
+	stats->bytesSent = load(m_bytesSent);
+	stats->droppedLatency = (unsigned int)load(m_droppedLatency);
+	stats->droppedQueueFull = (unsigned int)load(m_droppedQueueFull);
+	stats->droppedRingFull = (unsigned int)load(m_droppedRingFull);
+	stats->droppedNotPushing = (unsigned int)load(m_droppedNotPushing);
+	stats->partialWrites = (unsigned int)load(m_partialWrites);
+	stats->queuePackets = __atomic_load_n(&m_queuePackets, __ATOMIC_RELAXED);
+	stats->queueBytes = __atomic_load_n(&m_queueBytes, __ATOMIC_RELAXED);
+
+	uint64_t connects = load(m_connects);
+	stats->reconnects = (connects > 0) ? (unsigned int)(connects - 1) : 0;
+
+	m_latency.getStats(stats);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file SessionStats.h
+ * @brief  推送会话的发送统计
+ *
+ *	各计数器用 relaxed 原子操作累加, 读统计的线程不加锁, 也不会挡住发送路径;
+ *	读到的是各项各自最新的值, 不保证彼此在同一时刻.
+ *	包从入队(推送线程交来帧)到写入 socket 的延时记入一个 HDR 式的直方图:
+ *	按 2 的幂分段, 每段再线性分 16 格, 相对误差不超过 1/16, 范围 0 到约 71 分钟.
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-02
+ */
+#ifndef SESSION_STATS_H
+#define SESSION_STATS_H
+
+#include <stdint.h>
+#include "API_PusherTypes.h"
+
+class LatencyHistogram
+{
+	public:
+		enum
+		{
+			kSubBucketBits	= 4,
+			kSubBuckets		= 1 << kSubBucketBits,
+			kMaxValueBits	= 32,	// microseconds, larger values are clamped
+			kNumBuckets		= (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets
+		};
+
+		LatencyHistogram() { reset(); }
+		void reset();
+
+		void record(int64_t us)
+		{
+			if (us < 0) us = 0;
+			if (us >= ((int64_t)1 << kMaxValueBits)) us = ((int64_t)1 << kMaxValueBits) - 1;
+
+			__atomic_fetch_add(&m_counts[bucketIndex((uint32_t)us)], 1, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&m_samples, 1, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&m_sumUs, (uint64_t)us, __ATOMIC_RELAXED);
+
+			uint32_t max = __atomic_load_n(&m_maxUs, __ATOMIC_RELAXED);
+			while (((uint32_t)us > max)
+					&& !__atomic_compare_exchange_n(&m_maxUs, &max, (uint32_t)us, true,
+						__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				;
+		}
+
+		// fills the latency fields of "stats"
+		void getStats(PusherStats* stats) const;
+
+	private:
+		// Values below kSubBuckets have a bucket each; above, every power of
+		// two range is split into kSubBuckets equal parts.
+		static uint32_t bucketIndex(uint32_t v)
+		{
+			if (v < kSubBuckets) return v;
+			uint32_t shift = (31 - __builtin_clz(v)) - kSubBucketBits;
+			return (shift + 1) * kSubBuckets + ((v >> shift) & (kSubBuckets - 1));
+		}
+		// the largest value that lands in bucket "idx"
+		static uint32_t bucketHighest(uint32_t idx);
+
+	private:
+		uint64_t m_counts[kNumBuckets];
+		uint64_t m_samples;
+		uint64_t m_sumUs;
+		uint32_t m_maxUs;
+};
+
+class SessionStats
+{
+	public:
+		SessionStats() { reset(); }
+		void reset();
+
+		// frames handed to the transport: written, or queued to be
+		void onFrameSent() { add(m_framesSent, 1); }
+		// bytes the socket took, framing included
+		void onBytesSent(uint32_t bytes) { add(m_bytesSent, bytes); }
+		// a packet is done on the wire, "latencyUs" after it was queued
+		void onPacketSent(int64_t latencyUs) { m_latency.record(latencyUs); }
+		// the socket took part of a write only
+		void onPartialWrite() { add(m_partialWrites, 1); }
+
+		void onDroppedLatency(uint32_t n) { add(m_droppedLatency, n); }
+		void onDroppedQueueFull() { add(m_droppedQueueFull, 1); }
+		void onDroppedRingFull() { add(m_droppedRingFull, 1); }
+		void onDroppedNotPushing() { add(m_droppedNotPushing, 1); }
+
+		void setQueueDepth(uint32_t packets, uint32_t bytes)
+		{
+			__atomic_store_n(&m_queuePackets, packets, __ATOMIC_RELAXED);
+			__atomic_store_n(&m_queueBytes, bytes, __ATOMIC_RELAXED);
+		}
+		// a connection got to pushing; all but the first are reconnects
+		void onConnected() { add(m_connects, 1); }
+
+		void getStats(PusherStats* stats) const;
+
+	private:
+		static void add(uint64_t& counter, uint64_t n) { __atomic_fetch_add(&counter, n, __ATOMIC_RELAXED); }
+		static uint64_t load(const uint64_t& counter) { return __atomic_load_n(&counter, __ATOMIC_RELAXED); }
+
+	private:
+		uint64_t m_framesSent;
+		uint64_t m_bytesSent;
+		uint64_t m_partialWrites;
+		uint64_t m_droppedLatency;
+		uint64_t m_droppedQueueFull;
+		uint64_t m_droppedRingFull;
+		uint64_t m_droppedNotPushing;
+		uint64_t m_connects;
+		uint32_t m_queuePackets;
+		uint32_t m_queueBytes;
+		LatencyHistogram m_latency;
+};
+
+#endif
@@ -14,6 +14,24 @@
 #include "Socket.h"
 #include<netinet/tcp.h>
 #include <sys/uio.h>
+#ifndef __Win32__
+#include <poll.h>
+#endif
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60          // older headers; the kernel may still have it
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+#endif
 
 #ifdef USE_NETLOG
 	#include <netlog.h>
@@ -25,6 +43,8 @@
 
 Socket::Socket(uint32_t inSocketType)
 :   fState(inSocketType),
+    fZeroCopy(false),
+    fZeroCopyNextID(0),
     fLocalAddrStrPtr(NULL),
     fLocalDNSStrPtr(NULL),
     fPortStr(fPortBuffer, kPortBufSizeInBytes)
@@ -257,6 +277,108 @@ ET_Error Socket::WriteV(const struct iovec* iov, const uint32_t numIOvecs, uint3
     return ET_NoErr;
 }
 
+ET_Error Socket::SetZeroCopy(bool enable)
+{
+#if defined(__linux__)
+    int one = enable ? 1 : 0;
+    if (::setsockopt(fFileDesc, SOL_SOCKET, SO_ZEROCOPY, (char*)&one, sizeof(one)) == -1)
+        return (ET_Error)errno;
+    fZeroCopy = enable;
+    return ET_NoErr;
+#else
+    return enable ? (ET_Error)EOPNOTSUPP : ET_NoErr;
+#endif
+}
+
+ET_Error Socket::WriteVZeroCopy(const struct iovec* iov, const uint32_t numIOvecs, uint32_t* outLenSent,
+                                    uint32_t* outSendID, bool* outPinned)
+{
+    *outPinned = false;
+#if defined(__linux__)
+    if (fZeroCopy)
+    {
+        if (!(fState & kConnected))
+            return (ET_Error)ENOTCONN;
+
+        struct msghdr theMsg;
+        ::memset(&theMsg, 0, sizeof(theMsg));
+        theMsg.msg_iov = (struct iovec*)iov;
+        theMsg.msg_iovlen = numIOvecs;
+
+        int err;
+        do {
+            err = ::sendmsg(fFileDesc, &theMsg, MSG_ZEROCOPY);
+        } while ((err == -1) && (errno == EINTR));
+
+        if (err >= 0)
+        {
+            // only a send that took something gets a number
+            if (err > 0)
+            {
+                *outSendID = fZeroCopyNextID++;
+                *outPinned = true;
+            }
+            if (outLenSent != NULL)
+                *outLenSent = (uint32_t)err;
+            return ET_NoErr;
+        }
+        if (errno != ENOBUFS)
+        {
+            int theErr = errno;
+            if ((theErr != EAGAIN) && (this->IsConnected()))
+                fState ^= kConnected;//turn off connected state flag
+            return (ET_Error)theErr;
+        }
+        // ENOBUFS: over the socket's optmem limit for pinned pages, copy this one
+    }
+#endif
+    return this->WriteV(iov, numIOvecs, outLenSent);
+}
+
+ET_Error Socket::ReapZeroCopy(uint32_t* outFirst, uint32_t* outLast)
+{
+#if defined(__linux__)
+    for (;;)
+    {
+        char theControl[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr theMsg;
+        ::memset(&theMsg, 0, sizeof(theMsg));
+        theMsg.msg_control = theControl;
+        theMsg.msg_controllen = sizeof(theControl);
+
+        int err;
+        do {
+            err = ::recvmsg(fFileDesc, &theMsg, MSG_ERRQUEUE);
+        } while ((err == -1) && (errno == EINTR));
+        if (err == -1)
+            return (ET_Error)errno;
+
+        for (struct cmsghdr* theCmsg = CMSG_FIRSTHDR(&theMsg); theCmsg != NULL; theCmsg = CMSG_NXTHDR(&theMsg, theCmsg))
+        {
+            if (!((theCmsg->cmsg_level == SOL_IP) && (theCmsg->cmsg_type == IP_RECVERR)))
+                continue;
+
+            struct sock_extended_err theErr;
+            ::memcpy(&theErr, CMSG_DATA(theCmsg), sizeof(theErr));
+            if ((theErr.ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (theErr.ee_errno != 0))
+                continue;
+
+            // no gain where the device can't send from user pages (loopback, no SG)
+            if (theErr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                fZeroCopy = false;
+            *outFirst = theErr.ee_info;
+            *outLast = theErr.ee_data;
+            return ET_NoErr;
+        }
+        // something else on the error queue: skip it
+    }
+#else
+    (void)outFirst;
+    (void)outLast;
+    return (ET_Error)EAGAIN;
+#endif
+}
+
 ET_Error Socket::Read(void *buffer, const uint32_t length, uint32_t *outRecvLenP)
 {
     assert(outRecvLenP != NULL);
@@ -296,6 +418,7 @@ ET_Error Socket::RequestEvent(uint32_t evMask)
 {
 	int err = 0;
 
+#ifdef __Win32__
 	fd_set rdfds,wrfds;
 	timeval tv;
 	tv.tv_sec = 5;
@@ -312,6 +435,23 @@ ET_Error Socket::RequestEvent(uint32_t evMask)
 	do {
 		err = ::select(fFileDesc+1, &rdfds, &wrfds, 0, &tv);	
 	} while ((-1 == err) && (EINTR == errno));
+#else
+	// poll() rather than select(): an engine process easily has more
+	// than FD_SETSIZE descriptors open.
+	struct pollfd pfd;
+	pfd.fd = fFileDesc;
+	pfd.events = 0;
+	pfd.revents = 0;
+
+	if (evMask&EV_RE)
+		pfd.events |= POLLIN;
+	if (evMask&EV_WR)
+		pfd.events |= POLLOUT;
+
+	do {
+		err = ::poll(&pfd, 1, 5000);
+	} while ((-1 == err) && (EINTR == errno));
+#endif
 
 	if (err == 0) return ET_NETTIMEOUT;
 	else if (err < 0) return ET_NETERROR;
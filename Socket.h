@@ -68,6 +68,25 @@ class Socket
         //WriteV: same as send, but takes an iovec
         //Returns: QTSS_FileNotOpen, QTSS_NoErr, or POSIX errorcode.
         ET_Error        WriteV(const struct iovec* iov, const uint32_t numIOvecs, uint32_t* outLengthSent);
+
+        //MSG_ZEROCOPY (Linux 4.14+): large writes are sent straight from the
+        //caller's pages instead of being copied into the socket buffer.
+        //Returns: EOPNOTSUPP where it isn't available, ET_NoErr, or POSIX errorcode.
+        ET_Error        SetZeroCopy(bool enable);
+        bool            IsZeroCopy() { return fZeroCopy; }
+
+        //WriteVZeroCopy: WriteV, with MSG_ZEROCOPY if it is on. When outPinned
+        //comes back true the kernel still reads from iov after the call, and the
+        //pages must stay untouched until ReapZeroCopy has reported outSendID done.
+        //Returns: QTSS_FileNotOpen, QTSS_NoErr, or POSIX errorcode.
+        ET_Error        WriteVZeroCopy(const struct iovec* iov, const uint32_t numIOvecs, uint32_t* outLengthSent,
+                                        uint32_t* outSendID, bool* outPinned);
+
+        //ReapZeroCopy: takes the next notification off the error queue: the
+        //sends outFirst..outLast (inclusive) are done with their pages. Turns
+        //zero copy off once the kernel reports it had to copy anyway.
+        //Returns: EAGAIN if there is none, ET_NoErr, or POSIX errorcode.
+        ET_Error        ReapZeroCopy(uint32_t* outFirst, uint32_t* outLast);
         
         //You can query for the socket's state
         bool  IsConnected()   { return (bool) (fState & kConnected); }
@@ -105,6 +124,8 @@ class Socket
 
         uint32_t          fState;
 		int				  fFileDesc;
+        bool              fZeroCopy;
+        uint32_t          fZeroCopyNextID;  // the kernel numbers MSG_ZEROCOPY sends from 0
         enum
         {
             kPortBufSizeInBytes = 8,    //uint32_t
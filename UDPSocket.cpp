@@ -0,0 +1,220 @@
+/*
+    File:       UDPSocket.cpp
+
+    Contains:   implements UDPSocket class
+
+
+
+*/
+
+#include "common.h"
+#include "UDPSocket.h"
+#include <string.h>
+#if defined(__linux__)
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103     // older headers; the kernel may still have it
+#endif
+#endif
+
+void UDPSocket::SetDestination(uint32_t inRemoteAddr, uint16_t inRemotePort)
+{
+    ::memset(&fDestAddr, 0, sizeof(fDestAddr));
+    fDestAddr.sin_family = AF_INET;
+    fDestAddr.sin_port = htons(inRemotePort);
+    fDestAddr.sin_addr.s_addr = htonl(inRemoteAddr);
+}
+
+void UDPSocket::SetSegmentation(bool enable)
+{
+#if defined(__linux__)
+    fSegmenting = enable;
+#else
+    (void)enable;
+#endif
+}
+
+ET_Error UDPSocket::SendV(const struct iovec* inVecs, uint32_t inNumVecs)
+{
+    struct msghdr theMsg;
+    ::memset(&theMsg, 0, sizeof(theMsg));
+    theMsg.msg_name = &fDestAddr;
+    theMsg.msg_namelen = sizeof(fDestAddr);
+    theMsg.msg_iov = (struct iovec*)inVecs;
+    theMsg.msg_iovlen = inNumVecs;
+
+    int err;
+    do {
+        err = ::sendmsg(fFileDesc, &theMsg, 0);
+    } while ((err == -1) && (errno == EINTR));
+
+    if (err == -1)
+        return (ET_Error)errno;
+    return ET_NoErr;
+}
+
+ET_Error UDPSocket::RecvFrom(void* ioBuffer, uint32_t inSize, uint32_t* outRecvLen,
+                                uint32_t* outRemoteAddr, uint16_t* outRemotePort)
+{
+    struct sockaddr_in theAddr;
+    socklen_t theAddrLen = sizeof(theAddr);
+
+    int theRecvLen;
+    do {
+        theRecvLen = ::recvfrom(fFileDesc, (char*)ioBuffer, inSize, 0, (struct sockaddr*)&theAddr, &theAddrLen);
+    } while ((theRecvLen == -1) && (errno == EINTR));
+
+    if (theRecvLen == -1)
+        return (ET_Error)errno;
+
+    *outRecvLen = (uint32_t)theRecvLen;
+    if (outRemoteAddr != NULL)
+        *outRemoteAddr = ntohl(theAddr.sin_addr.s_addr);
+    if (outRemotePort != NULL)
+        *outRemotePort = ntohs(theAddr.sin_port);
+    return ET_NoErr;
+}
+
+ET_Error UDPSocket::SendDatagrams(const struct iovec* inVecs, const uint32_t* inVecCounts,
+                                    uint32_t inNumDatagrams, uint32_t* outNumSent)
+{
+    *outNumSent = 0;
+
+#if defined(__linux__)
+    if (fSegmenting)
+    {
+        ET_Error theErr = this->SendSegmented(inVecs, inVecCounts, inNumDatagrams, outNumSent);
+        if (fSegmenting || *outNumSent > 0)
+            return theErr;
+        // rejected: send them one datagram each from now on
+    }
+
+    while (*outNumSent < inNumDatagrams)
+    {
+        struct mmsghdr theMsgs[kMaxDatagramsPerSend];
+        uint32_t theNum = inNumDatagrams - *outNumSent;
+        if (theNum > kMaxDatagramsPerSend) theNum = kMaxDatagramsPerSend;
+
+        ::memset(theMsgs, 0, sizeof(theMsgs[0]) * theNum);
+        for (uint32_t i = 0; i < theNum; i++)
+        {
+            theMsgs[i].msg_hdr.msg_name = &fDestAddr;
+            theMsgs[i].msg_hdr.msg_namelen = sizeof(fDestAddr);
+            theMsgs[i].msg_hdr.msg_iov = (struct iovec*)inVecs;
+            theMsgs[i].msg_hdr.msg_iovlen = *inVecCounts;
+            inVecs += *inVecCounts++;
+        }
+
+        int err;
+        do {
+            err = ::sendmmsg(fFileDesc, theMsgs, theNum, 0);
+        } while ((err == -1) && (errno == EINTR));
+
+        if (err == -1)
+            return (*outNumSent > 0) ? ET_NoErr : (ET_Error)errno;
+
+        *outNumSent += (uint32_t)err;
+        if ((uint32_t)err < theNum)
+            break; // the socket buffer is full
+    }
+    return ET_NoErr;
+#else
+    for (; *outNumSent < inNumDatagrams; (*outNumSent)++)
+    {
+        ET_Error theErr = this->SendV(inVecs, *inVecCounts);
+        if (theErr != ET_NoErr)
+            return (*outNumSent > 0) ? ET_NoErr : theErr;
+        inVecs += *inVecCounts++;
+    }
+    return ET_NoErr;
+#endif
+}
+
+#if defined(__linux__)
+ET_Error UDPSocket::SendSegmented(const struct iovec* inVecs, const uint32_t* inVecCounts,
+                                    uint32_t inNumDatagrams, uint32_t* outNumSent)
+{
+    // Each message carries a run of datagrams of the same size (the last one
+    // may be shorter), and the kernel cuts it up again at that size.
+    struct mmsghdr theMsgs[kMaxDatagramsPerSend];
+    char theControl[kMaxDatagramsPerSend][CMSG_SPACE(sizeof(uint16_t))];
+    uint32_t theRunLens[kMaxDatagramsPerSend];
+
+    while (*outNumSent < inNumDatagrams)
+    {
+        uint32_t theNumMsgs = 0;
+        uint32_t theNumDatagrams = 0;
+        const struct iovec* theVecs = inVecs;
+        const uint32_t* theCounts = inVecCounts;
+
+        ::memset(theMsgs, 0, sizeof(theMsgs));
+        while ((*outNumSent + theNumDatagrams < inNumDatagrams) && (theNumMsgs < kMaxDatagramsPerSend))
+        {
+            struct msghdr& theHdr = theMsgs[theNumMsgs].msg_hdr;
+            theHdr.msg_name = &fDestAddr;
+            theHdr.msg_namelen = sizeof(fDestAddr);
+            theHdr.msg_iov = (struct iovec*)theVecs;
+
+            uint32_t theSegSize = 0;
+            uint32_t theBytes = 0;
+            uint32_t theRun = 0;
+            while ((*outNumSent + theNumDatagrams + theRun < inNumDatagrams) && (theRun < kMaxSegmentsPerSend))
+            {
+                uint32_t theLen = 0;
+                for (uint32_t i = 0; i < *theCounts; i++)
+                    theLen += (uint32_t)theVecs[i].iov_len;
+
+                if (theRun == 0)
+                    theSegSize = theLen;
+                else if ((theLen > theSegSize) || (theBytes + theLen > kMaxBytesPerSend))
+                    break;
+
+                theHdr.msg_iovlen += *theCounts;
+                theBytes += theLen;
+                theVecs += *theCounts++;
+                theRun++;
+                if (theLen < theSegSize)
+                    break; // a short one can only be the last of the run
+            }
+
+            if (theRun > 1)
+            {
+                theHdr.msg_control = theControl[theNumMsgs];
+                theHdr.msg_controllen = sizeof(theControl[theNumMsgs]);
+                struct cmsghdr* theCmsg = CMSG_FIRSTHDR(&theHdr);
+                theCmsg->cmsg_level = SOL_UDP;
+                theCmsg->cmsg_type = UDP_SEGMENT;
+                theCmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t theSegSize16 = (uint16_t)theSegSize;
+                ::memcpy(CMSG_DATA(theCmsg), &theSegSize16, sizeof(theSegSize16));
+            }
+
+            theRunLens[theNumMsgs++] = theRun;
+            theNumDatagrams += theRun;
+        }
+
+        int err;
+        do {
+            err = ::sendmmsg(fFileDesc, theMsgs, theNumMsgs, 0);
+        } while ((err == -1) && (errno == EINTR));
+
+        if (err == -1)
+        {
+            int theErr = errno;
+            if ((theErr == EIO) || (theErr == EINVAL) || (theErr == ENOPROTOOPT) || (theErr == EOPNOTSUPP))
+                fSegmenting = false; // no GSO on this kernel or route
+            return (*outNumSent > 0) ? ET_NoErr : (ET_Error)theErr;
+        }
+
+        for (int i = 0; i < err; i++)
+        {
+            *outNumSent += theRunLens[i];
+            for (uint32_t j = 0; j < theRunLens[i]; j++)
+                inVecs += *inVecCounts++;
+        }
+        if ((uint32_t)err < theNumMsgs)
+            break; // the socket buffer is full
+    }
+    return ET_NoErr;
+}
+#endif
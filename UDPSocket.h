@@ -0,0 +1,80 @@
+/*
+    File:       UDPSocket.h
+
+    Contains:   UDP socket object. Every datagram goes to one destination
+                (the server's RTP or RTCP port); many of them can be handed
+                to the kernel with a single sendmmsg. With segmentation on,
+                runs of equal-size datagrams go down as one UDP_SEGMENT (GSO)
+                buffer that the kernel splits up.
+
+
+*/
+
+#ifndef __UDPSOCKET_H__
+#define __UDPSOCKET_H__
+
+#ifndef __Win32__
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+#include "Socket.h"
+
+class UDPSocket : public Socket
+{
+    public:
+
+        enum
+        {
+            kMaxDatagramsPerSend = 64   // per sendmmsg call
+        };
+
+        UDPSocket(uint32_t inSocketType) : Socket(inSocketType), fSegmenting(false) {}
+        virtual ~UDPSocket() {}
+
+        //Open
+        ET_Error    Open() { return Socket::Open(SOCK_DGRAM); }
+
+        // Where every datagram is sent. The socket is left unconnected, so an
+        // ICMP error from the server never turns into a socket error.
+        void        SetDestination(uint32_t inRemoteAddr, uint16_t inRemotePort);
+        uint16_t    GetDestinationPort() { return ntohs(fDestAddr.sin_port); }
+
+        // UDP GSO for SendDatagrams. Linux only; turns itself off again the
+        // first time the kernel or the route rejects it.
+        void        SetSegmentation(bool enable);
+        bool        IsSegmenting() { return fSegmenting; }
+
+        // Sends one datagram, gathered from inVecs.
+        //Returns: EAGAIN if the socket buffer is full, ET_NoErr, or POSIX errorcode.
+        ET_Error    SendV(const struct iovec* inVecs, uint32_t inNumVecs);
+
+        // Sends inNumDatagrams datagrams, in order: datagram i is gathered from
+        // the next inVecCounts[i] entries of inVecs. outNumSent tells how many
+        // went out; the call returns ET_NoErr if any did.
+        //Returns: EAGAIN if none fit in the socket buffer, ET_NoErr, or POSIX errorcode.
+        ET_Error    SendDatagrams(const struct iovec* inVecs, const uint32_t* inVecCounts,
+                                    uint32_t inNumDatagrams, uint32_t* outNumSent);
+
+        // Reads one datagram, from whoever sent it; one longer than inSize is
+        // cut short.
+        //Returns: EAGAIN if there is none, ET_NoErr, or POSIX errorcode.
+        ET_Error    RecvFrom(void* ioBuffer, uint32_t inSize, uint32_t* outRecvLen,
+                                uint32_t* outRemoteAddr = NULL, uint16_t* outRemotePort = NULL);
+
+    private:
+
+        enum
+        {
+            kMaxSegmentsPerSend = 64,       // UDP_MAX_SEGMENTS
+            kMaxBytesPerSend    = 65000     // one IP datagram's worth, less the headers
+        };
+
+        ET_Error    SendSegmented(const struct iovec* inVecs, const uint32_t* inVecCounts,
+                                    uint32_t inNumDatagrams, uint32_t* outNumSent);
+
+        bool        fSegmenting;
+};
+
+#endif // __UDPSOCKET_H__
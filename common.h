@@ -58,10 +58,22 @@ enum
 	ET_NotInPushingState	=	-3,
 	ET_NotConn				=	-4,
 	ET_NoData				=	-5,
+	ET_NotSupported			=	-6,
 	ET_NETTIMEOUT			=	-10,
 	ET_NETERROR				=	-11
 };
 
+#include <stdint.h>
+#include <time.h>
+
+// microseconds on CLOCK_MONOTONIC, for timers and queueing times
+static inline int64_t monotonicUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 #include "MyLog.h"
 
 #endif
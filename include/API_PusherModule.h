@@ -24,6 +24,80 @@ extern "C"
 	_API RTSP_Pusher_Handler _APICALL RTSP_Pusher_Create();
 
 
+	/**
+	 * @brief  RTSP_Pusher_Engine_Create 
+	 *		创建推送引擎, 引擎内部持有 nThreads 个事件循环线程, 
+	 *		负责所有绑定推送流的连接建立、socket 事件和断开
+	 * @param nThreads	事件循环线程数
+	 *
+	 * @return  NULL or 推送引擎句柄
+	 */
+	_API RTSP_Pusher_Engine _APICALL RTSP_Pusher_Engine_Create(int nThreads);
+
+
+	/**
+	 * @brief  RTSP_Pusher_Engine_Release 
+	 *		释放推送引擎, 调用前应先释放所有绑定的推送流句柄
+	 * @param engine	推送引擎句柄
+	 *
+	 * @return   返回处理结果
+	 */
+	_API int _APICALL RTSP_Pusher_Engine_Release(RTSP_Pusher_Engine engine);
+
+
+	/**
+	 * @brief  RTSP_Pusher_Engine_SetMaxConnecting 
+	 *		设置引擎同时进行握手(连接/重连)的推送流数上限, 默认 64. 
+	 *		超出上限的推送流稍后再试, 避免服务器重启后所有推送流同时重连
+	 * @param engine		推送引擎句柄
+	 * @param maxConnecting	同时握手数上限
+	 *
+	 * @return   返回处理结果
+	 */
+	_API int _APICALL RTSP_Pusher_Engine_SetMaxConnecting(RTSP_Pusher_Engine engine, int maxConnecting);
+
+
+	/**
+	 * @brief  RTSP_Pusher_Engine_SetSendBatching 
+	 *		设置引擎的批量发送模式. 开启后 RTSP_Pusher_PushFrame 只把 RTP 包放入发送队列,
+	 *		由引擎线程在 flushWindowUs 微秒后(0: 本轮事件循环结束时)把每路推送流
+	 *		积攒的包用一次 writev 发出, 减少每个包的系统调用. 默认关闭
+	 * @param engine		推送引擎句柄
+	 * @param enable		nonzero 开启, 0 关闭
+	 * @param flushWindowUs	发送窗口, 单位微秒
+	 *
+	 * @return   返回处理结果
+	 */
+	_API int _APICALL RTSP_Pusher_Engine_SetSendBatching(RTSP_Pusher_Engine engine, int enable, unsigned int flushWindowUs);
+
+
+	/**
+	 * @brief  RTSP_Pusher_Engine_SetIoUring 
+	 *		设置引擎使用 io_uring 发送(仅 Linux 5.1 及以上, TCP interleaved 推送). 开启后
+	 *		RTP 包拷入预先注册的缓冲池, 每轮 flush 中所有推送流的写请求只用一次
+	 *		io_uring_enter 提交, 完成通知回到引擎线程. 开启即隐含批量发送(未设置
+	 *		SetSendBatching 时在本轮事件循环结束时 flush). io_uring 不可用时自动
+	 *		退回 writev. 默认关闭
+	 * @param engine		推送引擎句柄
+	 * @param enable		nonzero 开启, 0 关闭
+	 *
+	 * @return   返回处理结果
+	 */
+	_API int _APICALL RTSP_Pusher_Engine_SetIoUring(RTSP_Pusher_Engine engine, int enable);
+
+
+	/**
+	 * @brief  RTSP_Pusher_CreateWithEngine 
+	 *		创建绑定到推送引擎的推送流句柄. 此类句柄的 StartStream/CloseStream/
+	 *		Release 只投递到引擎线程后立即返回, 结果通过回调函数通知, 
+	 *		回调函数在引擎线程中执行
+	 * @param engine	推送引擎句柄
+	 *
+	 * @return  NULL or 推送流句柄 
+	 */
+	_API RTSP_Pusher_Handler _APICALL RTSP_Pusher_CreateWithEngine(RTSP_Pusher_Engine engine);
+
+
 	/**
 	 * @brief  RTSP_Pusher_SetCallback 
 	 *		推送流回调函数,　根据推送状态触发
@@ -40,17 +114,34 @@ extern "C"
 	 *		开始推送流
 	 * @param handler	推送流句柄
 	 * @param url		推送流RTSP URL
-	 * @param connType	RTP 数据推送连接类型: tcp or udp 
+	 * @param connType	RTP 数据推送连接类型: tcp or udp. RTP_OVER_UDP 时 RTSP 请求仍走 TCP,
+	 *					RTP 从本地偶数端口(RTCP 用其上的奇数端口)发往服务器 SETUP 应答中的
+	 *					server_port; 开启发送批处理时每次 flush 用一次 sendmmsg 发出
 	 * @param username  推送授权用户
 	 * @param password　授权用户密码
 	 * @param reconn　　推送流连接次数(当断开连接或连接失败时), 0:循环连接,
-	 *					nonzero 相应连接次数
+	 *					nonzero 相应连接次数. 重连间隔从 0.5s 起指数增长(带随机抖动),
+	 *					最长 30s; 重连时 SSRC 不变, RTP 序号和时间戳连续. 
+	 *					连接失败重试和断线重连只对在事件循环上运行的推送流(引擎句柄或 
+	 *					StartStreamAsync)有效; 同步 StartStream 只连接一次, 失败即返回
+	 *					错误, 不论 reconn 取值
 	 * @param mi		推送流媒体信息
 	 *
 	 * @return			返回处理结果 
 	 */
     _API int _APICALL RTSP_Pusher_StartStream(RTSP_Pusher_Handler handler, const char* url, RTP_ConnectType connType, const char* username, const char* password, int reconn, const MediaInfo& mi);
 
+	/**
+	 * @brief  RTSP_Pusher_StartStreamAsync 
+	 *		异步开始推送流: 立即返回, OPTIONS/ANNOUNCE/SETUP/PLAY 握手在事件循环线程上
+	 *		进行(句柄所属引擎的线程, 未绑定引擎的句柄使用库内部的共享引擎), 
+	 *		每个请求有独立的超时. 连接结果(CONNECTED 或 ERROR)通过回调函数通知.
+	 * @param 参数同 RTSP_Pusher_StartStream
+	 *
+	 * @return			返回处理结果, 0 表示握手已开始
+	 */
+    _API int _APICALL RTSP_Pusher_StartStreamAsync(RTSP_Pusher_Handler handler, const char* url, RTP_ConnectType connType, const char* username, const char* password, int reconn, const MediaInfo& mi);
+
 	/**
 	 * @brief  RTSP_Pusher_CloseStream 
 	 *		结束推送流
@@ -62,7 +153,8 @@ extern "C"
 
 	/**
 	 * @brief  RTSP_Pusher_Release 
-	 *		推送流数据资源释放
+	 *		推送流数据资源释放. 返回时此前排队的关闭等操作已执行完, 之后不会再调用
+	 *		该推送流的回调; 在事件循环线程上的回调中调用时, 释放在回调返回后进行
 	 * @param handler	推送流句柄
 	 *
 	 * @return   返回处理结果
@@ -80,6 +172,177 @@ extern "C"
 	 */
 	_API int _APICALL RTSP_Pusher_PushFrame(RTSP_Pusher_Handler handler, MediaFrame* frame);
 
+	/**
+	 * @brief  RTSP_Pusher_PushPCM 
+	 *		推送 16 位线性 PCM 数据, 由库编码后按 RTSP_Pusher_PushFrame 推送.
+	 *		frameData 为本机字节序的有符号 16 位采样, 多通道时交错排列, frameLen 为字节数.
+	 *		编码为 AUDIO_CODEC_G711 时编为 μ-law, AUDIO_CODEC_G711A 时编为 A-law,
+	 *		AUDIO_CODEC_IMAADPCM_8K/16K(单通道)时编为 IMA ADPCM 并带 DVI4 头,
+	 *		奇数个采样时最后一个留待下一帧; 其他编码返回 MC_NotSupported.
+	 *		MediaInfo 的 audioSamplerate 与编码的采样率不同时(如 44.1/48kHz 推送 PCMU),
+	 *		先经多相滤波重采样, 不支持的采样率比返回 MC_NotSupported
+	 * @param handler	推送流句柄
+	 * @param frame		PCM 数据帧
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_PushPCM(RTSP_Pusher_Handler handler, MediaFrame* frame);
+
+	/**
+	 * @brief  RTSP_Pusher_PushPCMBatch 
+	 *		一次为多个推送流调用 RTSP_Pusher_PushPCM. ADPCM 编码在单个流内是串行的,
+	 *		批量推送时各 DVI4 流并行编码, 每个流占一个 SIMD 通道, 适合同一线程按
+	 *		同一节奏推送大量流. 同一推送流在一批中只能出现一次, 推送期间不要在其他线程
+	 *		推送同一批中的流
+	 * @param handlers	推送流句柄数组
+	 * @param frames	对应的 PCM 数据帧数组
+	 * @param count		推送流个数
+	 * @param results	非 NULL 时逐个返回各帧的处理结果
+	 *
+	 * @return  推送失败的帧数, 0 表示全部成功 
+	 */
+	_API int _APICALL RTSP_Pusher_PushPCMBatch(RTSP_Pusher_Handler* handlers, MediaFrame** frames, int count, int* results);
+
+	/**
+	 * @brief  RTSP_Pusher_SetAsyncPush 
+	 *		设置异步推送模式, 须在 StartStream 之前调用. 开启后 RTSP_Pusher_PushFrame 
+	 *		只把帧拷入无锁环形队列(单生产者/单消费者)并在需要时唤醒网络线程, 
+	 *		打包和发送都在推送流所属的事件循环线程(未绑定引擎的句柄使用库内部的
+	 *		共享引擎)中进行, PUSHING 等回调也在该线程执行. 队列满时 PushFrame 
+	 *		返回错误, 该帧被丢弃. 同一推送流只能由一个线程调用 PushFrame
+	 * @param handler	推送流句柄
+	 * @param enable	nonzero 开启, 0 关闭
+	 * @param ringBytes	环形队列大小(字节), 0 使用默认值 64KB
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetAsyncPush(RTSP_Pusher_Handler handler, int enable, unsigned int ringBytes);
+
+	/**
+	 * @brief  RTSP_Pusher_SetPacketization 
+	 *		设置 RTP 打包方式. 一个 RTP 包不超过 mtu 减去 IP 和 UDP 头(28 字节).
+	 *		MP3(RFC 2250): 更大的帧拆成多个分片发送, 由 MPA 头的分片偏移标明位置;
+	 *		ptimeMs 非 0 时多个小帧合并进同一个包, 直到包满或包内音频达到该时长,
+	 *		会增加至多该时长的延时.
+	 *		G.711 和 DVI4(RFC 3551): 推送的帧可以是任意长度的采样数据, 按 ptimeMs
+	 *		(如 10/20/40/60)切成等长的包, 不足一个包的采样留待下一帧补齐; 为 0 时每帧
+	 *		一个包, 超过包长上限时按采样切分. 非 0 时 SDP 中带 a=ptime.
+	 *		断开时尚未发出的部分被丢弃. 默认 mtu 为 1500, ptimeMs 为 0.
+	 *		SDP 在 StartStream 时生成, 须在其之前调用
+	 * @param handler	推送流句柄
+	 * @param mtu		路径 MTU, 字节, 取值 576 到 65535
+	 * @param ptimeMs	每个包的音频时长(毫秒), 0 表示按帧打包
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetPacketization(RTSP_Pusher_Handler handler, unsigned int mtu, unsigned int ptimeMs);
+
+	/**
+	 * @brief  RTSP_Pusher_SetCallbackPolicy 
+	 *		设置回调方式, 须在 StartStream 之前调用. 默认每发出一帧回调一次 PUSHING.
+	 *		progressIntervalMs 非 0 时 PUSHING 与 CONGESTED 改为按间隔合并: 每个间隔内至多
+	 *		回调一次, PUSHING 的 rtspStatusCode 为自上次回调以来发出的帧数, CONGESTED 的为
+	 *		丢弃的包数; 连接、断开等状态变化仍立即回调, 并先报告已累计的部分.
+	 *		notifierThread 非 0 时所有回调改由库内的通知线程执行, 推送线程和网络线程只把
+	 *		事件放入无锁队列, 不会被回调阻塞; 通知队列满时丢弃 PUSHING/CONGESTED 事件.
+	 *		此时 RTSP_Pusher_Release 返回前会等已入队的回调执行完
+	 * @param handler				推送流句柄
+	 * @param progressIntervalMs	PUSHING/CONGESTED 的合并间隔(毫秒), 0 表示每帧回调
+	 * @param notifierThread		nonzero 在通知线程上回调, 0 在产生事件的线程上回调
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetCallbackPolicy(RTSP_Pusher_Handler handler, unsigned int progressIntervalMs, int notifierThread);
+
+	/**
+	 * @brief  RTSP_Pusher_SetSendQueueLimits 
+	 *		设置推送流发送队列上限. socket 暂时写不进去的 RTP 包先进入发送队列, 
+	 *		待 socket 可写时再发送; 队列满时 RTSP_Pusher_PushFrame 返回错误, 该帧被丢弃.
+	 *		默认 512 个包 / 256KB
+	 * @param handler		推送流句柄
+	 * @param maxPackets	队列最多缓存的包数
+	 * @param maxBytes		队列最多缓存的字节数
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetSendQueueLimits(RTSP_Pusher_Handler handler, unsigned int maxPackets, unsigned int maxBytes);
+
+	/**
+	 * @brief  RTSP_Pusher_SetLatencyBudget 
+	 *		设置推送流的延时预算. 在发送队列中等待超过 maxLatencyMs 的包被丢弃(先丢最老的),
+	 *		队列满时同样丢弃最老的包为新包腾出空间; 有包被丢弃时回调 PUSHER_STATE_CONGESTED,
+	 *		rtspStatusCode 为本次丢弃的包数. 0 表示不限制(默认), 队列满时丢弃新帧
+	 * @param handler		推送流句柄
+	 * @param maxLatencyMs	延时预算, 单位毫秒
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetLatencyBudget(RTSP_Pusher_Handler handler, unsigned int maxLatencyMs);
+
+	/**
+	 * @brief  RTSP_Pusher_GetSendQueueStatus 
+	 *		查询推送流发送队列状态
+	 * @param handler	推送流句柄
+	 * @param packets	输出: 队列中的包数, 可为 NULL
+	 * @param bytes		输出: 队列中的字节数, 可为 NULL
+	 * @param dropped	输出: 累计因延时预算丢弃的包数, 可为 NULL
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_GetSendQueueStatus(RTSP_Pusher_Handler handler, unsigned int* packets, unsigned int* bytes, unsigned int* dropped);
+
+	/**
+	 * @brief  RTSP_Pusher_SetUDPSegmentation 
+	 *		RTP_OVER_UDP 时开启 UDP GSO(UDP_SEGMENT): 一次发送中大小相同的连续 RTP 包
+	 *		合并成一个缓冲交给内核, 由内核切分成多个数据报, 减少每个包的协议栈开销.
+	 *		需配合发送批处理(RTSP_Pusher_Engine_SetSendBatching)才有效果. 仅 Linux 
+	 *		4.18 及以上支持; 内核或路由不支持时自动退回逐个数据报发送. 默认关闭
+	 * @param handler	推送流句柄
+	 * @param enable	1: 开启, 0: 关闭
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetUDPSegmentation(RTSP_Pusher_Handler handler, int enable);
+
+	/**
+	 * @brief  RTSP_Pusher_SetZeroCopy 
+	 *		RTP_OVER_TCP 时开启 MSG_ZEROCOPY: 发送队列中攒够 16KB 以上的一批数据直接从队列
+	 *		缓冲发出, 不再拷贝进内核 socket 缓冲, 这部分缓冲等内核通知发送完成后才复用.
+	 *		适合一次写出很多帧的场景(批量或快于实时的上传). 仅对引擎上的推送流有效, 宜配合
+	 *		发送批处理(RTSP_Pusher_Engine_SetSendBatching)使用; 仅 Linux 4.14 及以上支持, 网卡
+	 *		不支持(例如本机回环)时自动退回拷贝发送. 下次连接时生效, 默认关闭
+	 * @param handler	推送流句柄
+	 * @param enable	1: 开启, 0: 关闭
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_SetZeroCopy(RTSP_Pusher_Handler handler, int enable);
+
+	/**
+	 * @brief  RTSP_Pusher_GetRTCPStats 
+	 *		查询推送流本次连接的 RTCP 统计. 引擎上的推送流每隔约 5 秒发送一次 RTCP 发送者
+	 *		报告(SR, 含 NTP 与 RTP 时间戳的对应关系), RTP_OVER_TCP 时走 interleaved 通道 1,
+	 *		RTP_OVER_UDP 时走 RTCP 端口; 服务器回送的接收者报告(RR)给出往返时延、抖动和丢包.
+	 *		服务器不发 RR 时 reportsReceived 为 0
+	 * @param handler	推送流句柄
+	 * @param stats		输出: RTCP 统计
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_GetRTCPStats(RTSP_Pusher_Handler handler, RTCPStats* stats);
+
+	/**
+	 * @brief  RTSP_Pusher_GetStats 
+	 *		查询推送流的发送统计: 发出的帧数和字节数、按原因分列的丢弃数、部分写次数、
+	 *		当前队列深度、重连次数, 以及帧交给推送接口到写入 socket 的延时分布.
+	 *		不加锁, 可在任意线程随时调用, 不会阻塞推送; 各项各自取最新值
+	 * @param handler	推送流句柄
+	 * @param stats		输出: 发送统计
+	 *
+	 * @return  返回处理结果 
+	 */
+	_API int _APICALL RTSP_Pusher_GetStats(RTSP_Pusher_Handler handler, PusherStats* stats);
+
     /**
 	 * @brief  RTSP_Pusher_Get_MP3_Frame_Duration 
 	 *
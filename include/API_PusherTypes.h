@@ -18,6 +18,7 @@
 #endif
 
 #define RTSP_Pusher_Handler void*
+#define RTSP_Pusher_Engine void*
 
 enum
 {
@@ -26,6 +27,7 @@ enum
 	MC_BadURLFormat			=	-2,
 	MC_NotInPushingState	=	-3,
 	MC_NotConn				=	-4,	
+	MC_NotSupported			=	-6,		/* 当前编码不支持该操作 */
 };
 typedef  int MC_Error;
 
@@ -39,16 +41,18 @@ typedef struct MEDIA_FRAME_T
     double             duration;                /* frame broadcast duration , millisecond */
 } MediaFrame;
 
-#define AUDIO_CODEC_G711			0x00
+#define AUDIO_CODEC_G711			0x00		/* μ-law, PCMU */
+#define AUDIO_CODEC_G711A			0x08		/* A-law, PCMA */
 #define AUDIO_CODEC_MP3				0x0E
-#define AUDIO_CODEC_IMAADPCM_8K		0x05
+#define AUDIO_CODEC_IMAADPCM_8K		0x05		/* DVI4, 每帧以 RFC 3551 的 4 字节 DVI4 头开始 */
 #define AUDIO_CODEC_IMAADPCM_16K	0x06
 
 /* 推送流的媒体属性定义 */
 typedef struct MEDIA_INFO_T
 {
 	unsigned int audioCodec;			/* 音頻編碼类型*/
-	unsigned int audioSamplerate;		/* 音頻采样率*/
+	unsigned int audioSamplerate;		/* 音頻采样率. G.711 和 DVI4 的 RTP 时钟由编码决定(8000, IMAADPCM_16K
+										   为 16000), 此时为 RTSP_Pusher_PushPCM 输入的采样率, 与之不同时由库重采样 */
 	unsigned int audioChannel;			/* 音頻通道数*/
 } MediaInfo;
 
@@ -59,9 +63,12 @@ typedef enum PUSHER_STATE_T
     PUSHER_STATE_CONNECTED,              /* 连接成功 */
     PUSHER_STATE_CONNECT_FAILED,         /* 连接失败 */
     PUSHER_STATE_CONNECT_ABORT,          /* 连接异常中断 */
-    PUSHER_STATE_PUSHING,                /* 推流中 */
+    PUSHER_STATE_PUSHING,                /* 推流中, 按间隔合并回调时 rtspStatusCode 为
+                                            该间隔内发出的帧数 */
     PUSHER_STATE_DISCONNECTED,           /* 断开连接 */
-    PUSHER_STATE_ERROR
+    PUSHER_STATE_ERROR,
+    PUSHER_STATE_CONGESTED               /* 发送拥塞, 超出延时预算的包被丢弃, 
+                                            回调的 rtspStatusCode 为本次丢弃的包数 */
 } RTSP_Pusher_State;
 
 /* 连接类型 */
@@ -72,6 +79,42 @@ typedef enum __RTP_CONNECT_TYPE
 } RTP_ConnectType;
 
 
+/* 推送流的 RTCP 统计: 发送计数, 以及服务器最近一个接收报告(RR)中关于本流的内容 */
+typedef struct RTCP_STATS_T
+{
+	unsigned int packetsSent;		/* 本次连接已发送的 RTP 包数 */
+	unsigned int octetsSent;		/* 本次连接已发送的 RTP 负载字节数 */
+	unsigned int reportsReceived;	/* 收到的接收报告数, 为 0 时以下各项无效 */
+	unsigned int rttMs;				/* 往返时延, 毫秒; 服务器尚未收到发送者报告时为 0 */
+	unsigned int jitterMs;			/* 到达间隔抖动, 毫秒 */
+	unsigned int fractionLost;		/* 上一报告周期的丢包率, 单位 1/256 */
+	int          cumulativeLost;	/* 累计丢包数 */
+	unsigned int highestSeq;		/* 收到的最大序号(含回绕次数) */
+} RTCPStats;
+
+/* 推送流的发送统计, 自创建起累计(跨重连). 延时指帧交给推送接口到写入 socket 的时间,
+   按包统计, 分位数取自直方图, 相对误差不超过 1/16 */
+typedef struct PUSHER_STATS_T
+{
+	unsigned long long framesSent;		/* 已发出或已进入发送队列的帧数 */
+	unsigned long long bytesSent;		/* socket 已接受的字节数, 含 RTP 头与 interleaved 头 */
+	unsigned int droppedLatency;		/* 超出延时预算而丢弃的包数 */
+	unsigned int droppedQueueFull;		/* 发送队列已满而拒绝的帧数 */
+	unsigned int droppedRingFull;		/* 异步推送的帧缓冲已满而拒绝的帧数 */
+	unsigned int droppedNotPushing;		/* 连接中、重连中等非推送状态下丢弃的帧数 */
+	unsigned int partialWrites;			/* socket 只接受了一部分数据的写次数 */
+	unsigned int queuePackets;			/* 当前发送队列中的包数 */
+	unsigned int queueBytes;			/* 当前发送队列中的字节数 */
+	unsigned int reconnects;			/* 断线后重新连上的次数 */
+	unsigned long long latencySamples;	/* 计入延时统计的包数 */
+	unsigned int latencyMeanUs;			/* 平均延时, 微秒 */
+	unsigned int latencyP50Us;			/* 延时的 50/90/99/99.9 分位数, 微秒 */
+	unsigned int latencyP90Us;
+	unsigned int latencyP99Us;
+	unsigned int latencyP999Us;
+	unsigned int latencyMaxUs;			/* 最大延时, 微秒 */
+} PusherStats;
+
 /* 推送回调函数定义 obj 表示用户自定义数据 */
 typedef int (*PusherCallback)(RTSP_Pusher_State state, int rtspStatusCode, void *obj);
 
@@ -1,7 +1,6 @@
 #!/bin/bash
-prefix=$1
+server=$1
+prefix=$2
 
-for ((i=0; i<50; ++i))
-do  
-	./PusherModuleTest $1$i ./media &  
-done  
+# one process pushes <prefix>0 .. <prefix>49 through the pusher engine
+./PusherModuleTest $server $prefix ./media 50
@@ -0,0 +1,129 @@
+/**
+ * @file adpcm_check.cpp
+ * @brief  IMA ADPCM 各向量实现与标量实现逐位比对: 各种流数, 长度, 初始状态,
+ *	随机及满幅/静音等极端输入, 比较编码输出和编码后的状态
+ *
+ *	用法: AdpcmCheck [轮数], 全部一致时返回 0
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-16
+ */
+#include "ImaAdpcmEncoder.h"
+#include "CpuFeatures.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// more than one group of lanes, with some left over
+#define MAX_STREAMS	40
+#define MAX_SAMPLES	1000
+#define GUARD		0xA5
+
+static uint32_t s_seed = 1;
+
+static uint32_t nextRandom()
+{
+	s_seed = s_seed * 1664525 + 1013904223;
+	return s_seed >> 8;
+}
+
+// Input kinds: noise, full-scale square waves that drive the step index
+// and the predictor to their limits, silence, and a slow ramp.
+static void fill(int16_t* pcm, size_t n, int kind)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		switch (kind)
+		{
+			case 0: pcm[i] = (int16_t) nextRandom(); break;
+			case 1: pcm[i] = (i & 1) ? 32767 : -32768; break;
+			case 2: pcm[i] = (i & 8) ? 32767 : -32768; break;
+			case 3: pcm[i] = 0; break;
+			default: pcm[i] = (int16_t) (i * 37); break;
+		}
+	}
+}
+
+static void randomState(ImaAdpcmEncoder::State& state)
+{
+	static const int predictors[] = { -32768, -1, 0, 1, 32767 };
+	static const int indexes[] = { 0, 1, ImaAdpcmEncoder::kMaxIndex - 1, ImaAdpcmEncoder::kMaxIndex };
+
+	uint32_t r = nextRandom();
+	state.predictor = (r & 1) ? (int16_t) nextRandom() : predictors[nextRandom() % 5];
+	state.index = (r & 2) ? (int) (nextRandom() % (ImaAdpcmEncoder::kMaxIndex + 1)) : indexes[nextRandom() % 4];
+}
+
+static int16_t s_pcm[MAX_STREAMS][MAX_SAMPLES];
+static uint8_t s_ref[MAX_STREAMS][MAX_SAMPLES / 2];
+static uint8_t s_out[MAX_STREAMS][MAX_SAMPLES / 2 + 1];
+
+// One round: "count" streams of "n" samples through encodeStreams(),
+// each compared with encode() on its own.
+static int checkRound(int count, size_t n)
+{
+	ImaAdpcmEncoder::State start[MAX_STREAMS];
+	ImaAdpcmEncoder::State ref[MAX_STREAMS];
+	ImaAdpcmEncoder::State got[MAX_STREAMS];
+	ImaAdpcmEncoder::State* states[MAX_STREAMS];
+	const int16_t* pcm[MAX_STREAMS];
+	uint8_t* out[MAX_STREAMS];
+
+	for (int s = 0; s < count; s++)
+	{
+		fill(s_pcm[s], n, (int) (nextRandom() % 5));
+		randomState(start[s]);
+		ref[s] = start[s];
+		ImaAdpcmEncoder::encode(ref[s], s_pcm[s], s_ref[s], n);
+
+		got[s] = start[s];
+		states[s] = &got[s];
+		pcm[s] = s_pcm[s];
+		out[s] = s_out[s];
+		::memset(s_out[s], GUARD, sizeof(s_out[s]));
+	}
+
+	ImaAdpcmEncoder::encodeStreams(states, pcm, out, count, n);
+
+	for (int s = 0; s < count; s++)
+	{
+		if (::memcmp(s_out[s], s_ref[s], n / 2) != 0 || s_out[s][n / 2] != GUARD
+				|| got[s].predictor != ref[s].predictor || got[s].index != ref[s].index)
+		{
+			printf("  stream %d of %d, %u samples from %d/%d: ends at %d/%d, scalar %d/%d\n",
+					s, count, (unsigned) n, start[s].predictor, start[s].index,
+					got[s].predictor, got[s].index, ref[s].predictor, ref[s].index);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	// around the 16 sample blocks the kernels move at a time
+	static const size_t lengths[] = { 0, 2, 14, 16, 18, 30, 32, 34, 160, 322, MAX_SAMPLES };
+	int rounds = (argc > 1) ? atoi(argv[1]) : 20;
+	if (rounds <= 0) rounds = 20;
+
+	CpuFeatures::Level best = CpuFeatures::level();
+	int failed = 0;
+
+	for (int level = CpuFeatures::kScalar; level <= best; level++)
+	{
+		CpuFeatures::limit((CpuFeatures::Level) level);
+		int errors = 0;
+
+		for (int r = 0; r < rounds; r++)
+			for (int count = 1; count <= MAX_STREAMS; count++)
+				for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+					errors += checkRound(count, lengths[i]);
+
+		printf("up to %-7s kernel %-7s %s\n", CpuFeatures::name((CpuFeatures::Level) level),
+				ImaAdpcmEncoder::kernelName(), errors ? "FAILED" : "ok");
+		if (errors) failed = 1;
+	}
+	return failed;
+}
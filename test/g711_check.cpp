@@ -0,0 +1,114 @@
+/**
+ * @file g711_check.cpp
+ * @brief  G.711 各向量实现与标量实现逐字节比对: 两种律, 全部 65536 个输入,
+ *	奇数长度, 输入输出都不对齐
+ *
+ *	用法: G711Check, 全部一致时返回 0
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-16
+ */
+#include "G711Encoder.h"
+#include "CpuFeatures.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_INPUTS	65536
+#define MAX_PIECE	1023
+// room to shift the buffers and to catch writes past the end
+#define SLACK		64
+#define GUARD		0xA5
+
+static int16_t s_all[NUM_INPUTS];
+static uint8_t s_ref[NUM_INPUTS];
+static uint8_t s_out[NUM_INPUTS];
+static int16_t s_pcm[MAX_PIECE + SLACK];
+static uint8_t s_piece[MAX_PIECE + 2 * SLACK];
+
+// Encodes all inputs in pieces of odd lengths from "pcm + pcmShift" into
+// "out + outShift", comparing each piece and the bytes around it.
+static int checkPieces(G711Encoder::Law law, size_t pcmShift, size_t outShift)
+{
+	// below, at and above the 16 and 32 sample vectors
+	static const size_t lengths[] = { 1, 3, 7, 15, 17, 31, 33, 47, 63, 65, 97, 255, MAX_PIECE };
+	int16_t* pcm = s_pcm + pcmShift;
+	size_t done = 0;
+	int errors = 0;
+
+	for (size_t i = 0; done < NUM_INPUTS; i++)
+	{
+		size_t n = lengths[i % (sizeof(lengths) / sizeof(lengths[0]))];
+		if (n > NUM_INPUTS - done) n = NUM_INPUTS - done;
+
+		::memcpy(pcm, s_all + done, n * sizeof(int16_t));
+
+		uint8_t* out = s_piece + SLACK + outShift;
+		::memset(s_piece, GUARD, sizeof(s_piece));
+		G711Encoder::encode(law, pcm, out, n);
+
+		if (::memcmp(out, s_ref + done, n) != 0)
+		{
+			for (size_t k = 0; k < n; k++)
+			{
+				if (out[k] != s_ref[done + k])
+				{
+					printf("  input %d: got 0x%02x, scalar 0x%02x (length %u, shifts %u/%u)\n",
+							(int16_t) (done + k), out[k], s_ref[done + k], (unsigned) n,
+							(unsigned) pcmShift, (unsigned) outShift);
+					break;
+				}
+			}
+			errors++;
+		}
+		for (uint8_t* p = s_piece; p < s_piece + sizeof(s_piece); p++)
+		{
+			if ((p < out || p >= out + n) && *p != GUARD)
+			{
+				printf("  wrote outside the output (length %u, shifts %u/%u)\n",
+						(unsigned) n, (unsigned) pcmShift, (unsigned) outShift);
+				errors++;
+				break;
+			}
+		}
+		done += n;
+	}
+	return errors;
+}
+
+int main()
+{
+	static const G711Encoder::Law laws[] = { G711Encoder::kULaw, G711Encoder::kALaw };
+	static const char* lawNames[] = { "u-law", "a-law" };
+	CpuFeatures::Level best = CpuFeatures::level();
+	int failed = 0;
+
+	for (int i = 0; i < NUM_INPUTS; i++)
+		s_all[i] = (int16_t) i;
+
+	for (int l = 0; l < 2; l++)
+	{
+		CpuFeatures::limit(CpuFeatures::kScalar);
+		G711Encoder::encode(laws[l], s_all, s_ref, NUM_INPUTS);
+
+		for (int level = CpuFeatures::kScalar; level <= best; level++)
+		{
+			CpuFeatures::limit((CpuFeatures::Level) level);
+			int errors = 0;
+
+			// all inputs at once
+			G711Encoder::encode(laws[l], s_all, s_out, NUM_INPUTS);
+			if (::memcmp(s_out, s_ref, NUM_INPUTS) != 0) errors++;
+
+			for (size_t pcmShift = 0; pcmShift < 16; pcmShift++)
+				for (size_t outShift = 0; outShift < 32; outShift += 3)
+					errors += checkPieces(laws[l], pcmShift, outShift);
+
+			printf("%s  up to %-7s kernel %-7s %s\n", lawNames[l], CpuFeatures::name((CpuFeatures::Level) level),
+					G711Encoder::kernelName(), errors ? "FAILED" : "ok");
+			if (errors) failed = 1;
+		}
+	}
+	return failed;
+}
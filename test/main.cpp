@@ -1,6 +1,7 @@
 #include "API_PusherModule.h"
 
 #include <stdio.h>
+#include <math.h>
 #include <unistd.h>
 #include "media_src.h"
 #include "mp3Parser.h"
@@ -18,18 +19,30 @@
 
 #define PUSHER_DEBUG 1
 
+#define MAX_SESSIONS 4096
+
+/* one pushed stream: its handler, media source and pacing state */
+struct PushSession
+{
+	RTSP_Pusher_Handler handler;
+	MediaStream* stream;
+	DIR* dir;
+	bool running;
+	double mediaUs;			// media time pushed so far: the frames' durations summed
+	unsigned int frameIndex;
+	TaskToken pacingTask;
+	int64_t periodUs;
+	int64_t paceUs;			// media time the pacing ticks have reached
+};
+
 bool g_running = false;
 sem_t g_sem;
 
-static RTSP_Pusher_Handler g_pusher_handler = NULL;
-static MediaStream* g_media_stream = NULL;
-unsigned int g_timestampSec = 0;
-unsigned int g_timestampUsec = 0;
-unsigned int g_frameIndex = 0;
-unsigned long long g_lastFrameTimestamp = 0UL;
-#define MAX_NUMBER_FRAME_ADJUST  10
-int last10FrameSpendTimes[MAX_NUMBER_FRAME_ADJUST] = {0};
-int g_deltaDelayTime = 0;
+static RTSP_Pusher_Engine g_engine = NULL;
+static PushSession* g_sessions = NULL;
+static int g_numSessions = 1;
+static int g_activeSessions = 0;
+static const char* g_mediaDir = NULL;
 
 TaskScheduler* g_scheduler;
 UsageEnvironment* g_env;
@@ -42,6 +55,7 @@ static void SigHandle(int signo)
 		case SIGINT:
 		case SIGTERM:
 			g_running = false;
+			g_endEventLoop = 1;
 			printf("got SIGTERM sigal.\n");
 			break;
 		default:
@@ -52,6 +66,7 @@ static void SigHandle(int signo)
 static int PusherStateCallbackFunc(RTSP_Pusher_State state, int rtspStatusCode, void* obj)
 {
 	char cnt = 0;
+	PushSession* sess = (PushSession*) obj;
 	switch (state)
 	{
 		case PUSHER_STATE_CONNECTING:
@@ -59,15 +74,15 @@ static int PusherStateCallbackFunc(RTSP_Pusher_State state, int rtspStatusCode,
 			break;
 		case PUSHER_STATE_CONNECTED:
 			printf("connected .\n");
-			g_running = true;
+			sess->running = true;
 			break;
 		case PUSHER_STATE_CONNECT_FAILED:
 			printf("connect failed : %d!\n", rtspStatusCode);
-			g_running = false;
+			sess->running = false;
 			break;
 		case PUSHER_STATE_CONNECT_ABORT:
 			printf("connect abort !\n");
-			g_running = false;
+			sess->running = false;
 			break;
 		case PUSHER_STATE_PUSHING:
 			{
@@ -81,117 +96,130 @@ static int PusherStateCallbackFunc(RTSP_Pusher_State state, int rtspStatusCode,
 		}
 		case PUSHER_STATE_ERROR:
 			printf("occur an error .\n");
-			g_running = false;
+			sess->running = false;
+			break;
+		case PUSHER_STATE_CONGESTED:
+			printf("congested, %d packets dropped\n", rtspStatusCode);
 			break;
 	}
-	if (state != PUSHER_STATE_CONNECTING && state != PUSHER_STATE_PUSHING && state != PUSHER_STATE_DISCONNECTED)
+	if (state != PUSHER_STATE_CONNECTING && state != PUSHER_STATE_PUSHING && state != PUSHER_STATE_DISCONNECTED
+		&& state != PUSHER_STATE_CONGESTED)
 	{
 		sem_post(&g_sem);
 	}
     return 0;
 }
 
-void PushStreamTask(void* arg)
+static int OpenNextFile(PushSession* sess)
 {
-    MediaFrame mframe;
-	//FrameParser frmParser;
-	double duration = 0.0;
-    unsigned char buf[1400] = {0};
+	struct dirent *ptr;
 
-    int frameLen = 0;
-	int delaySendTime = 0;
-	int frameduration = 0;
-	bool sendnext = false;
+	if (sess->stream != NULL)
+	{
+		sess->stream->close();
+		delete sess->stream;
+		sess->stream = NULL;
+	}
 
-sendNextFrame :
+	while (g_running && (ptr = readdir(sess->dir)) != NULL)
+	{
+		if (strcmp(ptr->d_name, ".") == 0 || strcmp(ptr->d_name, "..") == 0 || ptr->d_type != 8) continue;
 
-	if ((g_media_stream != NULL) &&  (frameLen = g_media_stream->read_frame(buf, sizeof(buf))) <= 0)
-    {
-        g_endEventLoop = 1;
-		return;
-    }
-	else
-    {
-		//frmParser.ParseFrame(buf);
-		double duration = RTSP_Pusher_Get_MP3_Frame_Duration(buf); //frmParser.Duration();
-		g_timestampUsec += (duration * 1000);
-		g_timestampSec += g_timestampUsec / 1000000;
-		g_timestampUsec %= 1000000;
+		std::string file = g_mediaDir;
+		file += "/";
+		file +=  ptr->d_name;
 
-		mframe.frameLen = frameLen;
-		mframe.frameData = buf;
-        mframe.duration = duration;
+		sess->stream = MediaStream::getStream(MS_MPA_File);
+		if (sess->stream->open(file.c_str(), file.length()) < 0)
+		{
+			delete sess->stream;
+			sess->stream = NULL;
+			return -1;
+		}
 
-		mframe.timestampSec = g_timestampSec;
-		mframe.timestampUsec = g_timestampUsec;
-        g_frameIndex++;
+		return 0;
+	}
 
-        if (0 == RTSP_Pusher_PushFrame(g_pusher_handler, &mframe))
-		{
-		    delaySendTime = static_cast<int>(duration * 1000);
-			frameduration = delaySendTime;
-			struct timeval tv;
-            gettimeofday(&tv, NULL);
-			unsigned long long currentTimeStamp = tv.tv_sec*1000000+tv.tv_usec;
+	return -1;
+}
 
-			if ((g_lastFrameTimestamp != 0UL) && (currentTimeStamp - g_lastFrameTimestamp >= 2*delaySendTime))
-			{
-			    int throwFrameNumbers = (currentTimeStamp - g_lastFrameTimestamp - delaySendTime) / delaySendTime;
-                while(throwFrameNumbers > 0)
-				{
-				    g_media_stream->read_frame(buf, sizeof(buf));
-					printf("throw away throwFrameNumbers frames.\n");
-					throwFrameNumbers --;
-				}
-			}
-			
-			gettimeofday(&tv, NULL);
-			currentTimeStamp = tv.tv_sec*1000000+tv.tv_usec;
-			
-			printf("current is %llu, lasttimestamp is %llu, duration is %llu.\n", 
-				currentTimeStamp, g_lastFrameTimestamp, currentTimeStamp - g_lastFrameTimestamp);
-			if ((g_lastFrameTimestamp != 0UL) && (!sendnext))
-			{
-			    if (currentTimeStamp - g_lastFrameTimestamp > frameduration)
-				{
-					g_deltaDelayTime += (currentTimeStamp - g_lastFrameTimestamp - frameduration);
-				}
-				else
-				{
-					g_deltaDelayTime -= (frameduration - (currentTimeStamp - g_lastFrameTimestamp));
-				}
-
-                /* ǰ200usԤдǲѾһ֡ʱǵһ֡ */
-				if (g_deltaDelayTime + 200 > frameduration)  
-				{
-                    g_deltaDelayTime -= frameduration;
-					sendnext = true;
-					printf("called send next frame.\n");
-					goto sendNextFrame;
-				}
-			}
+static void StopSession(PushSession* sess)
+{
+	g_scheduler->unscheduleDelayedTask(sess->pacingTask);
+	if (--g_activeSessions == 0) g_endEventLoop = 1;
+}
 
-            if (g_lastFrameTimestamp != 0UL)
-			{
-			    if (currentTimeStamp - g_lastFrameTimestamp > frameduration)
-			    {
-                    delaySendTime = frameduration - (currentTimeStamp - g_lastFrameTimestamp - frameduration);
-			    }
-			    else
-			    {
-                    delaySendTime = frameduration;
-			    }
-			}
-			else
-			{
-                delaySendTime = frameduration;
-			}
+/* һ֡ǰļлһļûпƵ֡ʱ <= 0 */
+static int ReadNextFrame(PushSession* sess, unsigned char* buf, int size)
+{
+	int frameLen = 0;
+	while ((sess->stream != NULL) && (frameLen = sess->stream->read_frame(buf, size)) <= 0)
+	{
+		if (!sess->running || OpenNextFile(sess) != 0)
+			return -1;
+	}
+	return (sess->stream != NULL) ? frameLen : -1;
+}
+
+/*
+ *  schedulePeriodicTask ֡ʱڵ, ÿһ֡. ֻȡ΢, ֡ʱ
+ * (ÿ֡ / ) һ㲻΢, ԰ýʱ֡: 㲻ڱ
+ * (ݲ) ֡, ƫʱżչһ, ƫʱżһ֡, ۻƯ
+ */
+void PushStreamTask(void* arg, unsigned missedTicks)
+{
+	PushSession* sess = (PushSession*) arg;
+	MediaFrame mframe;
+	unsigned char buf[1400] = {0};
+	int frameLen = 0;
+	double duration = 0.0;
+	unsigned thrown = 0;
 
-			g_lastFrameTimestamp = currentTimeStamp;
+	sess->paceUs += (int64_t)(missedTicks + 1) * sess->periodUs;
+	int64_t dueUs = sess->paceUs + sess->periodUs / 2;
+	if (sess->mediaUs > dueUs)
+		return;
+
+	/* ʱ, ʱֱ֡ӶԱʵʱ, ʱճƽ */
+	for (;;)
+	{
+		if ((frameLen = ReadNextFrame(sess, buf, sizeof(buf))) <= 0)
+		{
+			StopSession(sess);
+			return;
+		}
+
+		duration = RTSP_Pusher_Get_MP3_Frame_Duration(buf);
+		sess->mediaUs += duration * 1000;
+		sess->frameIndex++;
+		bool nextDue = (sess->mediaUs <= dueUs);
+		if (nextDue && missedTicks > 0)
+		{
+			thrown++;
+			continue;
 		}
+
+		int64_t timestampUs = llround(sess->mediaUs);
+		mframe.frameLen = frameLen;
+		mframe.frameData = buf;
+		mframe.duration = duration;
+		mframe.timestampSec = (unsigned int) (timestampUs / 1000000);
+		mframe.timestampUsec = (unsigned int) (timestampUs % 1000000);
+		RTSP_Pusher_PushFrame(sess->handler, &mframe);
+		if (!nextDue)
+			break;
 	}
+	if (thrown > 0)
+		printf("throw away %u frames.\n", thrown);
 
-	g_env->taskScheduler().scheduleDelayedTask(delaySendTime, (TaskFunc*) PushStreamTask, arg);
+	/* ֡, ߻֡ʱͬļ: µ֡ʱµ */
+	int64_t periodUs = llround(duration * 1000);
+	if (periodUs != sess->periodUs)
+	{
+		g_scheduler->unscheduleDelayedTask(sess->pacingTask);
+		sess->periodUs = periodUs;
+		sess->pacingTask = g_scheduler->schedulePeriodicTask(periodUs, PushStreamTask, sess);
+	}
 }
 
 int main(int argc, char * argv[]) 
@@ -200,69 +228,104 @@ int main(int argc, char * argv[])
 
 	if (argc < 4)
 	{
-		printf("usage: ./PusherModuleTest <server> <session> <dir>\n");
+		printf("usage: ./PusherModuleTest <server> <session> <dir> [sessions]\n");
 		return ret;
 	}
 	
 	DIR *dir;
-	struct dirent *ptr;
-	char base[1000];
 			  
     if ((dir=opendir(argv[3])) == NULL)
 	{
 	    printf("open dir error... \n");
 	    return ret;
 	}
+	closedir(dir);
+	g_mediaDir = argv[3];
+
+	if (argc > 4) g_numSessions = atoi(argv[4]);
+	if (g_numSessions < 1) g_numSessions = 1;
+	if (g_numSessions > MAX_SESSIONS) g_numSessions = MAX_SESSIONS;
 
 	signal(SIGINT, SigHandle);
 	signal(SIGTERM, SigHandle);
 	sem_init(&g_sem, 0, 0);
+	g_running = true;
 
-	g_pusher_handler = RTSP_Pusher_Create();
+	/* more than one session: let an engine drive all of them in this process */
+	if (g_numSessions > 1)
+	{
+		g_engine = RTSP_Pusher_Engine_Create(sysconf(_SC_NPROCESSORS_ONLN));
+		if (g_engine == NULL)
+		{
+			printf("create engine error... \n");
+			return ret;
+		}
+	}
 
-	RTSP_Pusher_SetCallback(g_pusher_handler, PusherStateCallbackFunc, g_pusher_handler);
+	g_sessions = new PushSession[g_numSessions];
+	memset(g_sessions, 0, sizeof(PushSession) * g_numSessions);
 
 	MediaInfo mi;
 	mi.audioChannel = 2;
 	mi.audioCodec = AUDIO_CODEC_MP3;
 	mi.audioSamplerate = 44100;
+
+	for (int i = 0; i < g_numSessions; i++)
+	{
+		PushSession* sess = &g_sessions[i];
+		sess->dir = opendir(g_mediaDir);
+		sess->handler = (g_engine != NULL) ? RTSP_Pusher_CreateWithEngine(g_engine) : RTSP_Pusher_Create();
+
+		RTSP_Pusher_SetCallback(sess->handler, PusherStateCallbackFunc, sess);
 	
-	char url[128] = {0};
-	sprintf(url, "rtsp://%s/%s.sdp", argv[1], argv[2]);
-	ret = RTSP_Pusher_StartStream(g_pusher_handler, url, RTP_OVER_TCP, "1", 0, 1, mi);
+		char url[128] = {0};
+		if (g_numSessions > 1)
+			sprintf(url, "rtsp://%s/%s%d.sdp", argv[1], argv[2], i);
+		else
+			sprintf(url, "rtsp://%s/%s.sdp", argv[1], argv[2]);
+		ret = RTSP_Pusher_StartStreamAsync(sess->handler, url, RTP_OVER_TCP, "1", 0, 1, mi);
+	}
 	
-	while ((sem_wait(&g_sem) != 0));
+	for (int i = 0; i < g_numSessions; i++)
+	{
+		while ((sem_wait(&g_sem) != 0));
+	}
 
     g_scheduler = BasicTaskScheduler::createNew();
 	g_env = BasicUsageEnvironment::createNew(*g_scheduler);
-    g_lastFrameTimestamp = 0UL;            
 	g_endEventLoop = 0;
 	
-	while (g_running)
+	for (int i = 0; i < g_numSessions; i++)
 	{
-		if ((ptr=readdir(dir)) == NULL) break;
-		if (strcmp(ptr->d_name, ".") == 0 || strcmp(ptr->d_name, "..") == 0 || ptr->d_type != 8) continue;
-
-		g_media_stream = MediaStream::getStream(MS_MPA_File);
-		
-		std::string file = argv[3];
-		file += "/";
-		file +=  ptr->d_name;
+		PushSession* sess = &g_sessions[i];
+		if (!sess->running || OpenNextFile(sess) != 0) continue;
 
-		ret = g_media_stream->open(file.c_str(), file.length());
-		if (ret < 0) break;
+		g_activeSessions++;
+		PushStreamTask(sess, 0);
+	}
 
-        g_endEventLoop = 0;
-		g_lastFrameTimestamp = 0UL; 
-		g_deltaDelayTime = 0;
-		g_env->taskScheduler().scheduleDelayedTask(26000, (TaskFunc*) PushStreamTask, NULL);
+	if (g_activeSessions > 0)
 	    g_env->taskScheduler().doEventLoop(&g_endEventLoop);
-    }
 
     //getchar();
 	 
-    ret = RTSP_Pusher_CloseStream(g_pusher_handler);
-	RTSP_Pusher_Release(g_pusher_handler);
-	closedir(dir);
+	for (int i = 0; i < g_numSessions; i++)
+	{
+		PushSession* sess = &g_sessions[i];
+		ret = RTSP_Pusher_CloseStream(sess->handler);
+		RTSP_Pusher_Release(sess->handler);
+
+		if (sess->stream != NULL)
+		{
+			sess->stream->close();
+			delete sess->stream;
+		}
+		closedir(sess->dir);
+	}
+
+	if (g_engine != NULL)
+		RTSP_Pusher_Engine_Release(g_engine);
+
+	delete[] g_sessions;
 	return 0;
 }
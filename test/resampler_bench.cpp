@@ -0,0 +1,79 @@
+/**
+ * @file resampler_bench.cpp
+ * @brief  重采样单核吞吐量测试: 各常用采样率对每秒处理的输入采样数, 及单核可实时处理的流数
+ *
+ *	用法: ResamplerBench [每项秒数]
+ *	库须优化编译才有意义, 如 make -f Makefile.linux DEBUG=-O2 && make -f Makefile.linux bench
+ *
+ * @author lizhiyong0804319@gmail.com
+ * @version 1.0
+ * @date 2017-08-15
+ */
+#include "Resampler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+// 20ms frames, as a source would push them
+#define FRAME_MS 20
+
+static double nowSec()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char* argv[])
+{
+	static const unsigned int rates[][2] = {
+		{ 48000, 8000 }, { 44100, 8000 }, { 48000, 16000 }, { 44100, 16000 },
+		{ 32000, 8000 }, { 16000, 8000 }, { 8000, 16000 }
+	};
+	double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+	if (seconds <= 0) seconds = 1.0;
+
+	printf("kernel: %s\n", Resampler::kernelName());
+	printf("%-16s %6s %14s %14s\n", "rates", "ch", "Msamples/s", "streams/core");
+
+	for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+	{
+		for (unsigned int channels = 1; channels <= 2; channels++)
+		{
+			Resampler* resampler = Resampler::createNew(rates[i][0], rates[i][1], channels);
+			if (resampler == NULL)
+			{
+				printf("%6u -> %-6u %6u %14s\n", rates[i][0], rates[i][1], channels, "unsupported");
+				continue;
+			}
+
+			size_t frames = rates[i][0] * FRAME_MS / 1000;
+			int16_t* in = new int16_t[frames * channels];
+			int16_t* out = new int16_t[resampler->maxOutput(frames) * channels];
+			for (size_t k = 0; k < frames * channels; k++)
+				in[k] = (int16_t) (12000 * sin(2 * M_PI * 1000.0 * (k / channels) / rates[i][0]));
+
+			double start = nowSec();
+			double elapsed = 0;
+			unsigned long pushed = 0;
+			do
+			{
+				for (int k = 0; k < 100; k++)
+					resampler->process(in, frames, out);
+				pushed += 100;
+				elapsed = nowSec() - start;
+			} while (elapsed < seconds);
+
+			double samples = (double) pushed * frames / elapsed;	// per channel
+			printf("%6u -> %-6u %6u %14.1f %14.0f\n", rates[i][0], rates[i][1], channels,
+					samples * channels / 1e6, samples / rates[i][0]);
+
+			delete[] in;
+			delete[] out;
+			delete resampler;
+		}
+	}
+	return 0;
+}